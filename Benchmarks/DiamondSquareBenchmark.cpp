@@ -0,0 +1,119 @@
+/** Times seeded diamond square generation at several map sizes and
+    thread counts, checks that the output is bit-identical across thread
+    counts, and times the old single-threaded random() version at 1k.
+
+        g++ -O2 -std=c++11 -pthread Benchmarks/DiamondSquareBenchmark.cpp \
+            Utilities/DiamondSquare.cpp Utilities/ThreadPool.cpp Utilities/Trace.cpp -o diamondsquare_benchmark
+        ./diamondsquare_benchmark [sizes...]    (default: 1024 4096 16384) */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../Utilities/DiamondSquare.h"
+#include "../Utilities/ThreadPool.h"
+
+#define FEATURE_SIZE 256
+#define SEED 248
+
+using namespace std;
+
+/** Returns the time f takes in ms */
+template <typename F>
+static double timeRun(F f)
+{
+    chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+    f();
+    chrono::duration<double, milli> elapsed = chrono::high_resolution_clock::now() - start;
+    return elapsed.count();
+}
+
+/** FNV-1a over the map's bits */
+static uint64_t hashMap(const vector<float>& map)
+{
+    const unsigned char *bytes = (const unsigned char *) &map[0];
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < map.size() * sizeof(float); i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/** The generator Noise used to run: single threaded, random() per sample */
+static void legacyDiamondSquare(vector<float>& map, int size)
+{
+    int mask = size - 1;
+    auto sample = [&](int x, int y) { return map[(y & mask) * size + (x & mask)]; };
+    auto rand2 = []() { return -1.0f + (float) random() / RAND_MAX * 2.0f; };
+
+    for (int i = 0; i < size; i += FEATURE_SIZE)
+        for (int j = 0; j < size; j += FEATURE_SIZE)
+            map[(j & mask) * size + (i & mask)] = rand2();
+
+    float scale = 1.0;
+    for (int squareSize = FEATURE_SIZE; squareSize > 1; squareSize /= 2) {
+        int h = squareSize / 2;
+        for (int i = h; i < size + h; i += squareSize)
+            for (int j = h; j < size + h; j += squareSize)
+                map[(j & mask) * size + (i & mask)] = (sample(i - h, j - h) + sample(i + h, j - h) +
+                    sample(i - h, j + h) + sample(i + h, j + h)) / 4.0 + scale * rand2();
+        for (int i = h; i < size + h; i += squareSize) {
+            for (int j = h; j < size + h; j += squareSize) {
+                int x = i - h, y = j;
+                map[(y & mask) * size + (x & mask)] = (sample(x, y - h) + sample(x, y + h) +
+                    sample(x - h, y) + sample(x + h, y)) / 4.0 + scale * rand2();
+                x = i; y = j - h;
+                map[(y & mask) * size + (x & mask)] = (sample(x, y - h) + sample(x, y + h) +
+                    sample(x - h, y) + sample(x + h, y)) / 4.0 + scale * rand2();
+            }
+        }
+        scale /= 2.0;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    vector<int> sizes;
+    for (int i = 1; i < argc; i++)
+        sizes.push_back(atoi(argv[i]));
+    if (sizes.empty()) {
+        sizes.push_back(1024);
+        sizes.push_back(4096);
+        sizes.push_back(16384);
+    }
+
+    int maxThreads = thread::hardware_concurrency();
+
+    cout << "----- Diamond square benchmark -----" << endl;
+    {
+        vector<float> map(1024 * 1024);
+        double time = timeRun([&]() { legacyDiamondSquare(map, 1024); });
+        cout << " Old generator, 1024x1024: " << time << " ms" << endl;
+    }
+
+    for (size_t s = 0; s < sizes.size(); s++) {
+        int size = sizes[s];
+        vector<float> map((size_t) size * size);
+        uint64_t reference = 0;
+
+        cout << "------------------------------------" << endl;
+        cout << " " << size << "x" << size << " (" << map.size() * sizeof(float) / (1024 * 1024) << " MB)" << endl;
+
+        for (int threads = 1; threads <= maxThreads; threads *= 2) {
+            ThreadPool pool(threads);
+            double time = timeRun([&]() {
+                GenerateDiamondSquare(&map[0], size, FEATURE_SIZE, SEED, pool);
+                NormalizeDiamondSquare(&map[0], size, pool);
+            });
+            uint64_t hash = hashMap(map);
+            if (threads == 1)
+                reference = hash;
+            cout << " " << threads << " worker(s) + caller: " << time << " ms, "
+                 << (hash == reference ? "identical" : "DIFFERENT") << " output" << endl;
+        }
+    }
+
+    return 0;
+}
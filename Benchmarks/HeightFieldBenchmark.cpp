@@ -0,0 +1,113 @@
+/** Compares bitmap_image::get_interpolated_height (the old fetchZ path)
+    against HeightField's scalar, batched and SIMD sampling, on one
+    million random queries.
+
+    Run from the repository root so Textures/mars.bmp can be found:
+        g++ -O2 -std=c++11 -msse2 Benchmarks/HeightFieldBenchmark.cpp -o heightfield_benchmark
+        ./heightfield_benchmark [bitmap] */
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../Utilities/HeightField.hpp"
+#include "../Utilities/bitmap_image.hpp"
+
+#define QUERY_COUNT 1000000
+#define REPETITIONS 5
+
+using namespace std;
+
+/** Runs f REPETITIONS times and returns the best time in ns/query */
+template <typename F>
+static double timeQueries(F f)
+{
+    double best = 1e30;
+    for (int r = 0; r < REPETITIONS; r++) {
+        chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+        f();
+        chrono::duration<double, nano> elapsed = chrono::high_resolution_clock::now() - start;
+        if (elapsed.count() < best)
+            best = elapsed.count();
+    }
+    return best / QUERY_COUNT;
+}
+
+static float maxError(const vector<float>& a, const vector<float>& b)
+{
+    float error = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        error = fmaxf(error, fabsf(a[i] - b[i]));
+    }
+    return error;
+}
+
+int main(int argc, char *argv[])
+{
+    string filename = (argc > 1) ? argv[1] : "Textures/mars.bmp";
+    bitmap_image image(filename);
+    if (image.width() == 0) {
+        cerr << "Failed to load " << filename << endl;
+        return 1;
+    }
+
+    HeightField<float> heights(&image);
+    HeightField<uint16_t> heights16(&image);
+
+    // Queries inside the image, as fetchZ produces for the starting tile
+    mt19937 rng(248);
+    uniform_real_distribution<float> ux(0.0f, image.width() - 1.0f);
+    uniform_real_distribution<float> uy(0.0f, image.height() - 1.0f);
+    vector<float> xs(QUERY_COUNT), ys(QUERY_COUNT);
+    for (int i = 0; i < QUERY_COUNT; i++) {
+        xs[i] = ux(rng);
+        ys[i] = uy(rng);
+    }
+
+    vector<float> reference(QUERY_COUNT), out(QUERY_COUNT);
+
+    cout << "----- HeightField benchmark -----" << endl;
+    cout << " Image: " << filename << " (" << image.width() << "x" << image.height() << ")" << endl;
+    cout << " Queries: " << QUERY_COUNT << ", best of " << REPETITIONS << endl;
+    cout << "---------------------------------" << endl;
+
+    double bitmapTime = timeQueries([&]() {
+        for (int i = 0; i < QUERY_COUNT; i++)
+            reference[i] = image.get_interpolated_height(xs[i], ys[i]);
+    });
+    cout << " bitmap_image::get_interpolated_height: " << bitmapTime << " ns/query" << endl;
+
+    double scalarTime = timeQueries([&]() {
+        for (int i = 0; i < QUERY_COUNT; i++)
+            out[i] = heights.Sample(xs[i], ys[i]);
+    });
+    cout << " HeightField<float>::Sample:            " << scalarTime << " ns/query"
+         << " (" << bitmapTime / scalarTime << "x, max error " << maxError(reference, out) << ")" << endl;
+
+    double batchTime = timeQueries([&]() {
+        heights.Sample(&xs[0], &ys[0], &out[0], QUERY_COUNT);
+    });
+    cout << " HeightField<float>::Sample (batch):    " << batchTime << " ns/query"
+         << " (" << bitmapTime / batchTime << "x, max error " << maxError(reference, out) << ")" << endl;
+
+    double simdTime = timeQueries([&]() {
+        heights.SampleSIMD(&xs[0], &ys[0], &out[0], QUERY_COUNT);
+    });
+    cout << " HeightField<float>::SampleSIMD:        " << simdTime << " ns/query"
+         << " (" << bitmapTime / simdTime << "x, max error " << maxError(reference, out) << ")" << endl;
+
+    double simd16Time = timeQueries([&]() {
+        heights16.SampleSIMD(&xs[0], &ys[0], &out[0], QUERY_COUNT);
+    });
+    cout << " HeightField<uint16_t>::SampleSIMD:     " << simd16Time << " ns/query"
+         << " (" << bitmapTime / simd16Time << "x, max error " << maxError(reference, out) << ")" << endl;
+
+    cout << "---------------------------------" << endl;
+    cout << " Memory: bitmap " << image.width() * image.height() * 3 << " bytes, float "
+         << heights.GetMemoryUsage() << " bytes, uint16 " << heights16.GetMemoryUsage() << " bytes" << endl;
+
+    return 0;
+}
@@ -0,0 +1,118 @@
+/** Measures HeightPyramid ray cast throughput, single threaded and
+    through the ThreadPool batch API, and checks the hits against brute
+    force ray marching.
+
+    Run from the repository root so Textures/mars.bmp can be found:
+        g++ -O2 -std=c++11 -pthread Benchmarks/HeightPyramidBenchmark.cpp Utilities/ThreadPool.cpp \
+            Utilities/Trace.cpp -o heightpyramid_benchmark
+        ./heightpyramid_benchmark [bitmap] */
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Utilities/HeightField.hpp"
+#include "../Utilities/HeightPyramid.hpp"
+#include "../Utilities/ThreadPool.h"
+#include "../Utilities/bitmap_image.hpp"
+
+#define RAY_COUNT 100000
+#define CHECK_COUNT 1000
+#define REPETITIONS 5
+
+using namespace std;
+using namespace glm;
+
+/** Runs f REPETITIONS times and returns the best time in seconds */
+template <typename F>
+static double timeRuns(F f)
+{
+    double best = 1e30;
+    for (int r = 0; r < REPETITIONS; r++) {
+        chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+        f();
+        chrono::duration<double> elapsed = chrono::high_resolution_clock::now() - start;
+        if (elapsed.count() < best)
+            best = elapsed.count();
+    }
+    return best;
+}
+
+/** Reference: march in small steps and report the first step below ground */
+static bool march(const HeightField<float>& field, const TerrainRay& ray, float& t)
+{
+    const float step = 0.01f;
+    for (t = 0; t <= ray.tMax; t += step) {
+        vec3 p = ray.origin + t * ray.direction;
+        if (p.x < 0 || p.y < 0 || p.x > field.GetWidth() || p.y > field.GetHeight())
+            return false;
+        if (p.z <= field.Sample(p.x, p.y))
+            return true;
+    }
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    string filename = (argc > 1) ? argv[1] : "Textures/mars.bmp";
+    bitmap_image image(filename);
+    if (image.width() == 0) {
+        cerr << "Failed to load " << filename << endl;
+        return 1;
+    }
+
+    HeightField<float> field(&image);
+    HeightPyramid<float> pyramid(field);
+
+    // Gaze-like rays: from just above the terrain towards a point on it
+    mt19937 rng(248);
+    uniform_real_distribution<float> ux(0.0f, (float) field.GetWidth());
+    uniform_real_distribution<float> uy(0.0f, (float) field.GetHeight());
+    vector<TerrainRay> rays(RAY_COUNT);
+    for (int i = 0; i < RAY_COUNT; i++) {
+        vec3 from(ux(rng), uy(rng), 0);
+        from.z = field.Sample(from.x, from.y) + 0.1f;
+        vec3 to(ux(rng), uy(rng), 0);
+        to.z = field.Sample(to.x, to.y) - 0.01f;
+        rays[i] = TerrainRay(from, normalize(to - from), 2 * length(to - from));
+    }
+    vector<TerrainHit> hits(RAY_COUNT);
+
+    cout << "----- HeightPyramid benchmark -----" << endl;
+    cout << " Image: " << filename << " (" << field.GetWidth() << "x" << field.GetHeight()
+         << "), " << pyramid.GetLevelCount() << " levels" << endl;
+    cout << " Rays: " << RAY_COUNT << ", best of " << REPETITIONS << endl;
+    cout << "-----------------------------------" << endl;
+
+    // Correctness against marching
+    int agree = 0;
+    for (int i = 0; i < CHECK_COUNT; i++) {
+        TerrainHit hit;
+        float t;
+        bool marched = march(field, rays[i], t);
+        bool cast = pyramid.Intersect(rays[i], hit);
+        if (marched == cast && (!cast || fabsf(hit.t - t) < 0.02f))
+            agree++;
+    }
+    cout << " Agreement with ray marching: " << agree << "/" << CHECK_COUNT << endl;
+
+    double single = timeRuns([&]() {
+        pyramid.Intersect(&rays[0], &hits[0], RAY_COUNT);
+    });
+    cout << " 1 thread (no pool): " << RAY_COUNT / single / 1e6 << " Mrays/s" << endl;
+
+    int maxThreads = thread::hardware_concurrency();
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        ThreadPool pool(threads);
+        double pooled = timeRuns([&]() {
+            pyramid.Intersect(&rays[0], &hits[0], RAY_COUNT, &pool);
+        });
+        cout << " " << threads << " worker(s) + caller: " << RAY_COUNT / pooled / 1e6 << " Mrays/s" << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,283 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "PerfCounters.hpp"
+
+/* Runs thrown away before timing starts, to fill caches and let
+   the clock ramp up */
+#define MICROBENCHMARK_WARMUP_RUNS 3
+
+/* Timed runs per benchmark, unless asked for more */
+#define MICROBENCHMARK_RUNS 30
+
+/* Change in the median a baseline comparison puts down to noise */
+#define MICROBENCHMARK_TOLERANCE 0.10
+
+/** One benchmark's time per operation, in ns, across its timed runs,
+    and its counts per operation (-1 for counters not available) */
+struct MicrobenchmarkResult
+{
+    std::string name;
+    long operations;
+    double min, median, p90, p99, max;
+    double counters[PERF_COUNTERS];
+};
+
+/** A suite of small timed operations. Each benchmark is run a few times
+    to warm up, then repeatedly, and the spread of its times reported as
+    percentiles rather than one best or mean that a stray interrupt can
+    skew. Where Linux allows, hardware counters (cycles, instructions,
+    cache, branch and TLB misses) are read across the timed runs, so a
+    change to memory layout can be judged by the misses it saves as well
+    as the time. Results can be saved as a baseline and later runs
+    compared against it, so an optimization can be measured against the
+    code it replaces. */
+class Microbenchmarks
+{
+public:
+    /** Adds a benchmark. Every run calls f once, which must do the
+        measured operation the given number of times. */
+    void Add(const std::string& name, long operations, std::function<void()> f)
+    {
+        Benchmark benchmark = { name, operations, f };
+        benchmarks.push_back(benchmark);
+    }
+
+    /** Runs the benchmarks whose names contain filter, printing each
+        one's times as it finishes */
+    void Run(const std::string& filter = "", int runs = MICROBENCHMARK_RUNS)
+    {
+        StreamFormat format(std::cout);
+        ReportUnavailableCounters();
+        std::cout << "Time per operation over " << runs << " runs (ns):" << std::endl;
+        for (size_t i = 0; i < benchmarks.size(); i++) {
+            const Benchmark& benchmark = benchmarks[i];
+            if (benchmark.name.find(filter) == std::string::npos)
+                continue;
+
+            for (int r = 0; r < MICROBENCHMARK_WARMUP_RUNS; r++)
+                benchmark.run();
+
+            std::vector<double> times;
+            perf.Start();
+            for (int r = 0; r < runs; r++) {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                benchmark.run();
+                std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+                times.push_back(elapsed.count() / benchmark.operations);
+            }
+            perf.Stop();
+            std::sort(times.begin(), times.end());
+
+            MicrobenchmarkResult result;
+            result.name = benchmark.name;
+            result.operations = benchmark.operations;
+            result.min = times.front();
+            result.median = Percentile(times, 0.5);
+            result.p90 = Percentile(times, 0.9);
+            result.p99 = Percentile(times, 0.99);
+            result.max = times.back();
+            for (int c = 0; c < PERF_COUNTERS; c++) {
+                double count = perf.Get(c);
+                result.counters[c] = (count >= 0) ? count / ((double) runs * benchmark.operations) : -1;
+            }
+            results.push_back(result);
+
+            std::cout << "  " << result.name << ": median " << result.median << ", min "
+                      << result.min << ", p90 " << result.p90 << ", p99 " << result.p99
+                      << ", max " << result.max << std::endl;
+            if (perf.IsAnyAvailable()) {
+                PrintCounters("per op", result.counters, 1);
+                if (benchmark.operations > 1)
+                    PrintCounters("per run", result.counters, (double) benchmark.operations);
+            }
+        }
+    }
+
+    const std::vector<MicrobenchmarkResult>& GetResults() const { return results; }
+
+    /** Writes the results as a baseline: one tab separated line per
+        benchmark. Returns false if the file can't be written. */
+    bool SaveBaseline(const std::string& path) const
+    {
+        std::ofstream out(path.c_str());
+        if (!out) {
+            std::cerr << "Warning: unable to write the baseline to " << path << std::endl;
+            return false;
+        }
+        out << std::fixed << std::setprecision(1);
+        out << "# name\toperations\tmedian_ns\tp90_ns";
+        for (int c = 0; c < PERF_COUNTERS; c++)
+            out << "\t" << PerfCounters::GetName(c) << " per op";
+        out << std::endl;
+        for (size_t i = 0; i < results.size(); i++) {
+            out << results[i].name << "\t" << results[i].operations << "\t"
+                << results[i].median << "\t" << results[i].p90;
+            out << std::setprecision(4);
+            for (int c = 0; c < PERF_COUNTERS; c++)
+                out << "\t" << results[i].counters[c];
+            out << std::setprecision(1);
+            out << std::endl;
+        }
+        return true;
+    }
+
+    /** Compares the results' medians, and their counts where both have
+        them, with a saved baseline. Returns the number that got slower
+        by more than the tolerance, or -1 if the baseline can't be read. */
+    int CompareBaseline(const std::string& path) const
+    {
+        std::ifstream in(path.c_str());
+        if (!in) {
+            std::cerr << "Warning: unable to read the baseline " << path << std::endl;
+            return -1;
+        }
+        std::map<std::string, MicrobenchmarkResult> baseline;
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.empty() || line[0] == '#')
+                continue;
+            std::istringstream fields(line);
+            MicrobenchmarkResult result;
+            if (!std::getline(fields, result.name, '\t') || !(fields >> result.operations >> result.median >> result.p90))
+                continue;
+            // Baselines from before counters were read have none
+            for (int c = 0; c < PERF_COUNTERS; c++) {
+                if (!(fields >> result.counters[c]))
+                    result.counters[c] = -1;
+            }
+            baseline[result.name] = result;
+        }
+
+        int regressions = 0;
+        StreamFormat format(std::cout);
+        std::cout << "Against " << path << ":" << std::endl;
+        for (size_t i = 0; i < results.size(); i++) {
+            std::map<std::string, MicrobenchmarkResult>::const_iterator it = baseline.find(results[i].name);
+            if (it == baseline.end()) {
+                std::cout << "  " << results[i].name << ": not in the baseline" << std::endl;
+                continue;
+            }
+            const MicrobenchmarkResult& before = it->second;
+            double change = results[i].median / before.median - 1;
+            std::cout << "  " << results[i].name << ": " << before.median << " -> " << results[i].median
+                      << " ns (" << (change >= 0 ? "+" : "") << change * 100 << "%)";
+            if (change > MICROBENCHMARK_TOLERANCE) {
+                std::cout << " slower";
+                regressions++;
+            }
+            else if (change < -MICROBENCHMARK_TOLERANCE) {
+                std::cout << " faster";
+            }
+            std::cout << std::endl;
+
+            std::cout.unsetf(std::ios::floatfield);
+            std::cout << std::setprecision(4);
+            for (int c = 0; c < PERF_COUNTERS; c++) {
+                if (before.counters[c] < 0 || results[i].counters[c] < 0)
+                    continue;
+                std::cout << "    " << PerfCounters::GetName(c) << " per op: " << before.counters[c]
+                          << " -> " << results[i].counters[c] << std::endl;
+            }
+            std::cout << std::fixed << std::setprecision(1);
+        }
+        return regressions;
+    }
+
+private:
+    /** Prints times to a tenth of a ns, whatever their size, until
+        it goes out of scope */
+    class StreamFormat
+    {
+    public:
+        StreamFormat(std::ostream& out)
+        : out(out), flags(out.flags()), precision(out.precision())
+        {
+            out << std::fixed << std::setprecision(1);
+        }
+
+        ~StreamFormat()
+        {
+            out.flags(flags);
+            out.precision(precision);
+        }
+
+    private:
+        std::ostream& out;
+        std::ios::fmtflags flags;
+        std::streamsize precision;
+    };
+
+    /** Says which counters can't be read, once */
+    void ReportUnavailableCounters()
+    {
+        if (countersReported)
+            return;
+        countersReported = true;
+        if (!perf.IsAnyAvailable()) {
+            std::cerr << "Warning: no performance counters can be read; "
+                      << "see /proc/sys/kernel/perf_event_paranoid" << std::endl;
+            return;
+        }
+        std::string missing;
+        for (int c = 0; c < PERF_COUNTERS; c++) {
+            if (!perf.IsAvailable(c))
+                missing += std::string(missing.empty() ? "" : ", ") + PerfCounters::GetName(c);
+        }
+        if (!missing.empty())
+            std::cerr << "Warning: these can't be counted here: " << missing << std::endl;
+    }
+
+    /** Prints counts per operation, multiplied by scale, to four
+        significant figures, as there can be far less than one per
+        operation */
+    void PrintCounters(const char *label, const double counters[], double scale) const
+    {
+        std::ios::fmtflags flags = std::cout.flags();
+        std::cout.unsetf(std::ios::floatfield);
+        std::cout << std::setprecision(4) << "    " << label << ":";
+        const char *separator = " ";
+        for (int c = 0; c < PERF_COUNTERS; c++) {
+            if (counters[c] < 0)
+                continue;
+            std::cout << separator << counters[c] * scale << " " << PerfCounters::GetName(c);
+            separator = ", ";
+        }
+        if (counters[PERF_CYCLES] > 0 && counters[PERF_INSTRUCTIONS] >= 0)
+            std::cout << " (" << counters[PERF_INSTRUCTIONS] / counters[PERF_CYCLES] << " per cycle)";
+        std::cout << std::endl;
+        std::cout.flags(flags);
+        std::cout << std::setprecision(1);
+    }
+
+    struct Benchmark
+    {
+        std::string name;
+        long operations;
+        std::function<void()> run;
+    };
+
+    /** Nearest rank percentile of sorted times */
+    static double Percentile(const std::vector<double>& sorted, double fraction)
+    {
+        size_t rank = (size_t) (fraction * sorted.size() + 0.5);
+        return sorted[std::min(std::max(rank, (size_t) 1), sorted.size()) - 1];
+    }
+
+    std::vector<Benchmark> benchmarks;
+    std::vector<MicrobenchmarkResult> results;
+
+    /** Opened with the suite, so the threads benchmarks start are counted */
+    PerfCounters perf;
+    bool countersReported = false;
+};
@@ -0,0 +1,202 @@
+/** Microbenchmarks for the Utilities' hot paths: OBJ parsing and
+    vertex welding, noise generation, Texture::GetNormalMap,
+    bitmap_image::get_interpolated_height, Program::SetUniform and
+    CMSpline evaluation. The ones that need OpenGL run on an offscreen
+    context, and are skipped where there is none.
+
+    Run from the repository root so the models, textures and shaders
+    can be found:
+        make microbenchmarks
+        ./microbenchmarks [--filter=<text>] [--runs=<count>]
+                          [--save=<baseline>] [--baseline=<baseline>]
+
+    --save writes the medians and counts to a baseline file; --baseline
+    compares against one, and exits with 1 if anything got slower.
+    Hardware counters need perf_event_paranoid at 2 or lower, and a
+    machine (or virtual machine) that exposes them. */
+
+#ifdef __APPLE__
+#include <GLUT/glut.h>
+#else
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <GL/glut.h>
+#endif
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Microbenchmark.hpp"
+#include "../Utilities/CMSpline.hpp"
+#include "../Utilities/HeadlessContext.h"
+#include "../Utilities/Noise.h"
+#include "../Utilities/OBJFile.h"
+#include "../Utilities/Program.h"
+#include "../Utilities/Texture.h"
+#include "../Utilities/bitmap_image.hpp"
+
+#define HEIGHT_QUERIES 100000
+#define SPLINE_POINTS 1000000
+#define UNIFORM_CALLS 10000
+#define SMALL_OBJ_PARSES 100
+
+using namespace std;
+using namespace glm;
+
+/* Keeps results alive, so the work isn't optimized away */
+static volatile float sink;
+
+static void addOBJBenchmarks(Microbenchmarks& suite)
+{
+    suite.Add("OBJFile parse and weld icosphere.obj", SMALL_OBJ_PARSES, [] {
+        for (int i = 0; i < SMALL_OBJ_PARSES; i++) {
+            OBJFile obj("Models/icosphere.obj");
+            sink = (float) obj.indices.size();
+        }
+    });
+    suite.Add("OBJFile parse and weld apollo_lunar_module.obj", 1, [] {
+        OBJFile obj("Models/apollo_lunar_module.obj");
+        sink = (float) obj.indices.size();
+    });
+}
+
+static void addHeightBenchmarks(Microbenchmarks& suite, bitmap_image *bitmap)
+{
+    // The same walk of random points each run
+    mt19937 random(248);
+    uniform_real_distribution<float> u(0, bitmap->width() - 1), v(0, bitmap->height() - 1);
+    vector<vec2> points(HEIGHT_QUERIES);
+    for (size_t i = 0; i < points.size(); i++)
+        points[i] = vec2(u(random), v(random));
+
+    suite.Add("bitmap_image::get_interpolated_height", HEIGHT_QUERIES, [bitmap, points] {
+        float sum = 0;
+        for (size_t i = 0; i < points.size(); i++)
+            sum += bitmap->get_interpolated_height(points[i].x, points[i].y);
+        sink = sum;
+    });
+}
+
+static void addSplineBenchmarks(Microbenchmarks& suite)
+{
+    CMSpline spline(vec3(0, 0, 0), vec3(1, 2, 0), vec3(3, 1, 1), vec3(4, 4, 2));
+    suite.Add("CMSpline::evaluate3D", SPLINE_POINTS, [spline] {
+        vec3 sum(0);
+        for (int i = 0; i < SPLINE_POINTS; i++)
+            sum += spline.evaluate3D(i / (float) SPLINE_POINTS);
+        sink = sum.x + sum.y + sum.z;
+    });
+    suite.Add("CMSpline::tangent3D", SPLINE_POINTS, [spline] {
+        vec3 sum(0);
+        for (int i = 0; i < SPLINE_POINTS; i++)
+            sum += spline.tangent3D(i / (float) SPLINE_POINTS);
+        sink = sum.x + sum.y + sum.z;
+    });
+}
+
+/* The rest need a current OpenGL context */
+
+static void addTextureBenchmarks(Microbenchmarks& suite, Texture *heightMap)
+{
+    suite.Add("Noise 1024x1024", 1, [] {
+        Noise *noise = new Noise();
+        sink = (float) noise->GetID();
+        delete noise;
+    });
+    suite.Add("Texture::GetNormalMap mars.bmp", 1, [heightMap] {
+        Texture *normals = heightMap->GetNormalMap();
+        sink = (float) normals->GetID();
+        delete normals;
+    });
+}
+
+static void addUniformBenchmarks(Microbenchmarks& suite, Program *program, Texture *texture)
+{
+    mat4 matrix(1);
+    suite.Add("Program::SetUniform int", UNIFORM_CALLS, [program] {
+        for (int i = 0; i < UNIFORM_CALLS; i++)
+            program->SetUniform("bumpMapped", (GLint) (i & 1));
+    });
+    suite.Add("Program::SetUniform vec3", UNIFORM_CALLS, [program] {
+        for (int i = 0; i < UNIFORM_CALLS; i++)
+            program->SetUniform("lightPosition", vec3((float) i, 0, 1));
+    });
+    suite.Add("Program::SetUniform mat4", UNIFORM_CALLS, [program, matrix] {
+        for (int i = 0; i < UNIFORM_CALLS; i++)
+            program->SetUniform("model", matrix);
+    });
+    suite.Add("Program::SetUniform texture", UNIFORM_CALLS, [program, texture] {
+        for (int i = 0; i < UNIFORM_CALLS; i++)
+            program->SetUniform("heightMap", texture, GL_TEXTURE0);
+    });
+    suite.Add("Program::SetUniform missing", UNIFORM_CALLS, [program] {
+        for (int i = 0; i < UNIFORM_CALLS; i++)
+            program->SetUniform("notInTheShader", 1.0f);
+    });
+}
+
+int main(int argc, char *argv[])
+{
+    string filter, savePath, baselinePath;
+    int runs = MICROBENCHMARK_RUNS;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--filter=", 9) == 0) {
+            filter = argv[i] + 9;
+        }
+        else if (strncmp(argv[i], "--runs=", 7) == 0) {
+            runs = max(atoi(argv[i] + 7), 1);
+        }
+        else if (strncmp(argv[i], "--save=", 7) == 0) {
+            savePath = argv[i] + 7;
+        }
+        else if (strncmp(argv[i], "--baseline=", 11) == 0) {
+            baselinePath = argv[i] + 11;
+        }
+        else {
+            cerr << "Usage: " << argv[0] << " [--filter=<text>] [--runs=<count>]"
+                 << " [--save=<baseline>] [--baseline=<baseline>]" << endl;
+            return 1;
+        }
+    }
+
+    Microbenchmarks suite;
+    bitmap_image heights("Textures/mars.bmp");
+    addOBJBenchmarks(suite);
+    addHeightBenchmarks(suite, &heights);
+    addSplineBenchmarks(suite);
+
+    HeadlessContext context(64, 64);
+    bool gl = context.IsValid();
+#ifndef __APPLE__
+    glewExperimental = GL_TRUE;
+    gl = gl && glewInit() == GLEW_OK;
+#endif
+    Texture *heightMap = NULL;
+    Program *program = NULL;
+    if (gl) {
+        heightMap = new Texture("Textures/mars.bmp");
+        program = new Program("Shaders/main.vert", "Shaders/main.frag");
+        program->Use();
+        addTextureBenchmarks(suite, heightMap);
+        addUniformBenchmarks(suite, program, heightMap);
+    }
+    else {
+        cerr << "Warning: no OpenGL context, so only the CPU benchmarks are run" << endl;
+    }
+
+    suite.Run(filter, runs);
+
+    int regressions = 0;
+    if (!savePath.empty())
+        suite.SaveBaseline(savePath);
+    if (!baselinePath.empty())
+        regressions = suite.CompareBaseline(baselinePath);
+
+    delete program;
+    delete heightMap;
+    return regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,135 @@
+/** Times normal map generation: the old per-pixel loop from
+    Texture::GetNormalMap against NormalMap::Generate, on mars.bmp and
+    on a synthetic 8k x 8k height field.
+
+    Run from the repository root so Textures/mars.bmp can be found:
+        g++ -O2 -std=c++11 -pthread Benchmarks/NormalMapBenchmark.cpp Utilities/NormalMap.cpp \
+            Utilities/Texture.cpp Utilities/FBO.cpp Utilities/Program.cpp Utilities/Screen.cpp \
+            Utilities/RenderBuffer.cpp Utilities/Model.cpp Utilities/Buffer.cpp Utilities/ThreadPool.cpp \
+            Utilities/Trace.cpp Utilities/ResourceRegistry.cpp -lGLEW -lGL -o normalmap_benchmark
+        ./normalmap_benchmark [synthetic size] */
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../Utilities/HeightField.hpp"
+#include "../Utilities/NormalMap.h"
+#include "../Utilities/ThreadPool.h"
+#include "../Utilities/bitmap_image.hpp"
+
+#define REPETITIONS 3
+
+using namespace std;
+using namespace glm;
+
+/** Runs f REPETITIONS times and returns the best time in ms */
+template <typename F>
+static double timeRuns(F f)
+{
+    double best = 1e30;
+    for (int r = 0; r < REPETITIONS; r++) {
+        chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+        f();
+        chrono::duration<double, milli> elapsed = chrono::high_resolution_clock::now() - start;
+        if (elapsed.count() < best)
+            best = elapsed.count();
+    }
+    return best;
+}
+
+/** The loop Texture::GetNormalMap used to run (minus the disk write) */
+static void legacyNormals(bitmap_image& bitmap, bitmap_image& image)
+{
+    for (int x = 0; x < bitmap.width(); x++)
+    {
+        for (int y = 0; y < bitmap.height(); y++)
+        {
+            float dx = (bitmap.get_height(x + 1, y) - bitmap.get_height(x - 1, y)) / 2.0f;
+            float dy = (bitmap.get_height(x, y + 1) - bitmap.get_height(x, y - 1)) / 2.0f;
+
+            vec3 x_dir = vec3(1, 0, 70 * dx);
+            vec3 y_dir = vec3(0, 1, 70 * dy);
+            vec3 normal = normalize(cross(x_dir, y_dir)) / 2.0f;
+            normal += vec3(0.5);
+
+            image.set_pixel(x, y, 255 * normal.r, 255 * normal.g, 255 * normal.b);
+        }
+    }
+}
+
+/** Counts pixels that differ by more than one step in any channel,
+    ignoring the edges (the old loop wrapped x - 1 and y - 1 wrongly) */
+static int countDifferences(bitmap_image& a, bitmap_image& b)
+{
+    int differences = 0;
+    for (unsigned int y = 1; y + 1 < a.height(); y++) {
+        for (unsigned int x = 1; x + 1 < a.width(); x++) {
+            unsigned char ar, ag, ab, br, bg, bb;
+            a.get_pixel(x, y, ar, ag, ab);
+            b.get_pixel(x, y, br, bg, bb);
+            if (abs(ar - br) > 1 || abs(ag - bg) > 1 || abs(ab - bb) > 1)
+                differences++;
+        }
+    }
+    return differences;
+}
+
+static void benchmarkThreads(const HeightField<float>& heights, bitmap_image& image)
+{
+    int maxThreads = thread::hardware_concurrency();
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        ThreadPool pool(threads);
+        double time = timeRuns([&]() { NormalMap::Generate(heights, image, pool); });
+        cout << " NormalMap::Generate, " << threads << " worker(s) + caller: " << time << " ms" << endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int syntheticSize = (argc > 1) ? atoi(argv[1]) : 8192;
+
+    cout << "----- Normal map benchmark -----" << endl;
+
+    bitmap_image mars("Textures/mars.bmp");
+    if (mars.width() == 0) {
+        cerr << "Failed to load Textures/mars.bmp" << endl;
+        return 1;
+    }
+    cout << " mars.bmp (" << mars.width() << "x" << mars.height() << "), best of " << REPETITIONS << endl;
+
+    bitmap_image legacy(mars.width(), mars.height());
+    double legacyTime = timeRuns([&]() { legacyNormals(mars, legacy); });
+    cout << " Old Texture::GetNormalMap loop: " << legacyTime << " ms" << endl;
+
+    double fieldTime = timeRuns([&]() { HeightField<float> heights(&mars); });
+    cout << " HeightField from bitmap: " << fieldTime << " ms" << endl;
+
+    HeightField<float> heights(&mars);
+    bitmap_image image(mars.width(), mars.height());
+    benchmarkThreads(heights, image);
+    cout << " Interior pixels differing from the old loop: " << countDifferences(legacy, image) << endl;
+
+    cout << "--------------------------------" << endl;
+
+    // Synthetic terrain: a few octaves of sines
+    cout << " Synthetic " << syntheticSize << "x" << syntheticSize << ", best of " << REPETITIONS << endl;
+    vector<float> synthetic((size_t) syntheticSize * syntheticSize);
+    for (int y = 0; y < syntheticSize; y++) {
+        for (int x = 0; x < syntheticSize; x++) {
+            float u = x * 6.2831853f / syntheticSize, v = y * 6.2831853f / syntheticSize;
+            synthetic[(size_t) y * syntheticSize + x] = 0.5f + 0.25f * sinf(3 * u) * cosf(2 * v)
+                + 0.125f * sinf(17 * u + 5 * v) + 0.0625f * cosf(61 * v - 29 * u);
+        }
+    }
+    HeightField<float> large(syntheticSize, syntheticSize, &synthetic[0]);
+    synthetic.clear();
+    synthetic.shrink_to_fit();
+    bitmap_image largeImage(syntheticSize, syntheticSize);
+    benchmarkThreads(large, largeImage);
+
+    return 0;
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+#include <stdint.h>
+
+/** Counters read around each benchmark */
+enum PerfCounter
+{
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_DTLB_MISSES,
+    PERF_PAGE_FAULTS,
+    PERF_COUNTERS
+};
+
+/** Hardware performance counters for the calling thread and the threads
+    it starts afterwards (such as a thread pool's), through Linux's
+    perf_event_open, counting user space only. Each counter is opened on
+    its own, so one the CPU or kernel doesn't offer (or a virtual machine
+    hides) leaves the rest working. When there are more counters than the
+    PMU has registers the kernel takes turns between them, and the counts
+    are scaled up by the share of the time each was counting.
+
+    Elsewhere, and where perf_event_paranoid forbids it, nothing is
+    available and every count is -1. */
+class PerfCounters
+{
+public:
+    PerfCounters()
+    {
+        for (int i = 0; i < PERF_COUNTERS; i++) {
+            fds[i] = Open(i);
+            values[i] = -1;
+        }
+    }
+
+    ~PerfCounters()
+    {
+#ifdef __linux__
+        for (int i = 0; i < PERF_COUNTERS; i++) {
+            if (fds[i] >= 0)
+                close(fds[i]);
+        }
+#endif
+    }
+
+    bool IsAvailable(int counter) const { return fds[counter] >= 0; }
+
+    bool IsAnyAvailable() const
+    {
+        for (int i = 0; i < PERF_COUNTERS; i++) {
+            if (IsAvailable(i))
+                return true;
+        }
+        return false;
+    }
+
+    static const char *GetName(int counter)
+    {
+        static const char *names[PERF_COUNTERS] = {
+            "cycles", "instructions", "L1D misses", "LLC misses",
+            "branch misses", "dTLB misses", "page faults"
+        };
+        return names[counter];
+    }
+
+    /** Zeroes the counters and starts counting */
+    void Start()
+    {
+#ifdef __linux__
+        for (int i = 0; i < PERF_COUNTERS; i++) {
+            if (fds[i] >= 0) {
+                ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+                ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    /** Stops counting and reads the counts */
+    void Stop()
+    {
+#ifdef __linux__
+        for (int i = 0; i < PERF_COUNTERS; i++) {
+            if (fds[i] >= 0)
+                ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+        for (int i = 0; i < PERF_COUNTERS; i++) {
+            values[i] = -1;
+            uint64_t read[3];
+            if (fds[i] < 0 || ::read(fds[i], read, sizeof(read)) != sizeof(read))
+                continue;
+            // Value, time enabled, time running
+            values[i] = (read[2] > 0) ? (double) read[0] * read[1] / read[2] : 0;
+        }
+#endif
+    }
+
+    /** Returns a counter's count between the last Start and Stop, or -1
+        if it isn't available */
+    double Get(int counter) const { return values[counter]; }
+
+private:
+    static int Open(int counter)
+    {
+#ifdef __linux__
+        struct perf_event_attr attributes;
+        memset(&attributes, 0, sizeof(attributes));
+        attributes.size = sizeof(attributes);
+        attributes.disabled = 1;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        attributes.inherit = 1;
+        attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        // Cache events name the cache, the access and the result
+        const uint64_t readMiss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attributes.type = PERF_TYPE_HARDWARE;
+        switch (counter) {
+            case PERF_CYCLES:
+                attributes.config = PERF_COUNT_HW_CPU_CYCLES;
+                break;
+            case PERF_INSTRUCTIONS:
+                attributes.config = PERF_COUNT_HW_INSTRUCTIONS;
+                break;
+            case PERF_L1D_MISSES:
+                attributes.type = PERF_TYPE_HW_CACHE;
+                attributes.config = PERF_COUNT_HW_CACHE_L1D | readMiss;
+                break;
+            case PERF_LLC_MISSES:
+                attributes.type = PERF_TYPE_HW_CACHE;
+                attributes.config = PERF_COUNT_HW_CACHE_LL | readMiss;
+                break;
+            case PERF_BRANCH_MISSES:
+                attributes.config = PERF_COUNT_HW_BRANCH_MISSES;
+                break;
+            case PERF_DTLB_MISSES:
+                attributes.type = PERF_TYPE_HW_CACHE;
+                attributes.config = PERF_COUNT_HW_CACHE_DTLB | readMiss;
+                break;
+            default:
+                attributes.type = PERF_TYPE_SOFTWARE;
+                attributes.config = PERF_COUNT_SW_PAGE_FAULTS;
+                break;
+        }
+        return (int) syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+#else
+        return -1;
+#endif
+    }
+
+    int fds[PERF_COUNTERS];
+    double values[PERF_COUNTERS];
+};
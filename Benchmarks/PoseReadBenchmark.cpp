@@ -0,0 +1,125 @@
+/** Times reading the latest head pose while a sensor thread publishes
+    a new one every millisecond: through a mutex, as a render thread
+    polling the HMD would, against SensorThread's Seqlock. Also checks
+    that no read ever sees a half written pose.
+
+        g++ -O2 -std=c++11 -pthread Benchmarks/PoseReadBenchmark.cpp -o poseread_benchmark
+        ./poseread_benchmark [reads per run] */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "../Utilities/Seqlock.hpp"
+
+#define REPETITIONS 20
+
+using namespace std;
+
+/** The shape of SensorThread's Pose, without GLM */
+struct Pose
+{
+    double time;
+    float orientation[4];
+    float angularVelocity[3];
+};
+
+/** Runs f REPETITIONS times and returns the best time in ms */
+template <typename F>
+static double timeRuns(F f)
+{
+    double best = 1e30;
+    for (int r = 0; r < REPETITIONS; r++) {
+        chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+        f();
+        chrono::duration<double, milli> elapsed = chrono::high_resolution_clock::now() - start;
+        if (elapsed.count() < best)
+            best = elapsed.count();
+    }
+    return best;
+}
+
+/** A pose whose fields all hold the same counter, so a torn read
+    shows up as fields that disagree */
+static Pose makePose(int n)
+{
+    Pose pose;
+    pose.time = n;
+    for (int i = 0; i < 4; i++)
+        pose.orientation[i] = (float) n;
+    for (int i = 0; i < 3; i++)
+        pose.angularVelocity[i] = (float) n;
+    return pose;
+}
+
+static bool isTorn(const Pose& pose)
+{
+    for (int i = 0; i < 4; i++)
+        if (pose.orientation[i] != (float) pose.time)
+            return true;
+    for (int i = 0; i < 3; i++)
+        if (pose.angularVelocity[i] != (float) pose.time)
+            return true;
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    int reads = (argc > 1) ? atoi(argv[1]) : 1000000;
+
+    mutex poseMutex;
+    Pose locked = makePose(0);
+    Seqlock<Pose> published;
+
+    // The sensor thread: a new pose every millisecond
+    atomic<bool> running(true);
+    thread sensor([&] {
+        chrono::steady_clock::time_point next = chrono::steady_clock::now();
+        for (int n = 1; running; n++) {
+            Pose pose = makePose(n);
+            {
+                lock_guard<mutex> lock(poseMutex);
+                locked = pose;
+            }
+            published.Write(pose);
+            next += chrono::milliseconds(1);
+            this_thread::sleep_until(next);
+        }
+    });
+
+    int torn = 0;
+    volatile double sink = 0;
+
+    double mutexTime = timeRuns([&] {
+        for (int i = 0; i < reads; i++) {
+            Pose pose;
+            {
+                lock_guard<mutex> lock(poseMutex);
+                pose = locked;
+            }
+            torn += isTorn(pose);
+            sink = sink + pose.time;
+        }
+    });
+
+    double seqlockTime = timeRuns([&] {
+        for (int i = 0; i < reads; i++) {
+            Pose pose = published.Read();
+            torn += isTorn(pose);
+            sink = sink + pose.time;
+        }
+    });
+
+    running = false;
+    sensor.join();
+
+    cout << reads << " reads, sensor at 1 kHz, "
+         << published.GetVersion() << " poses published" << endl;
+    cout << "  mutex:   " << mutexTime << " ms (" << mutexTime * 1e6 / reads << " ns/read)" << endl;
+    cout << "  seqlock: " << seqlockTime << " ms (" << seqlockTime * 1e6 / reads << " ns/read)" << endl;
+    cout << "  torn reads: " << torn << endl;
+    return torn ? 1 : 0;
+}
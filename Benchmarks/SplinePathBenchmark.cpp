@@ -0,0 +1,147 @@
+/** Times camera path evaluation: one point at a time with the old
+    CMSpline (pow() per term, binary search over the arc length table)
+    against SplinePath's scalar and batched SSE2 calls, and checks the
+    batched results against the scalar ones.
+
+        g++ -O2 -std=c++11 Benchmarks/SplinePathBenchmark.cpp Utilities/SplinePath.cpp \
+            -o splinepath_benchmark
+        ./splinepath_benchmark [control points] [samples per frame] */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "../Utilities/SplinePath.h"
+#include "../Utilities/Random.h"
+
+#define REPETITIONS 20
+
+using namespace std;
+using namespace glm;
+
+/** Runs f REPETITIONS times and returns the best time in ms */
+template <typename F>
+static double timeRuns(F f)
+{
+    double best = 1e30;
+    for (int r = 0; r < REPETITIONS; r++) {
+        chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+        f();
+        chrono::duration<double, milli> elapsed = chrono::high_resolution_clock::now() - start;
+        if (elapsed.count() < best)
+            best = elapsed.count();
+    }
+    return best;
+}
+
+/** What evaluating a path used to cost: per-point pow() cubics,
+    located by binary search over the chord length table */
+struct LegacyPath
+{
+    vector<vec3> c1, c2, c3, c4;
+    vector<float> lengths;
+
+    LegacyPath(const vector<vec3>& points) {
+        for (size_t i = 0; i + 3 < points.size(); i++) {
+            c1.push_back(points[i + 1]);
+            c2.push_back(0.5f * (points[i + 2] - points[i]));
+            c3.push_back(points[i] - 2.5f * points[i + 1] + 2.0f * points[i + 2] - 0.5f * points[i + 3]);
+            c4.push_back(-0.5f * points[i] + 1.5f * points[i + 1] - 1.5f * points[i + 2] + 0.5f * points[i + 3]);
+        }
+        lengths.push_back(0.0f);
+        vec3 previous = Evaluate(0, 0.0f);
+        for (size_t s = 0; s < c1.size(); s++) {
+            for (int i = 1; i <= PATH_SAMPLES_PER_SEGMENT; i++) {
+                vec3 point = Evaluate(s, i / (float) PATH_SAMPLES_PER_SEGMENT);
+                lengths.push_back(lengths.back() + length(point - previous));
+                previous = point;
+            }
+        }
+    }
+
+    vec3 Evaluate(size_t s, float u) const {
+        return vec3(c1[s].x + c2[s].x * u + c3[s].x * pow(u, 2) + c4[s].x * pow(u, 3),
+                    c1[s].y + c2[s].y * u + c3[s].y * pow(u, 2) + c4[s].y * pow(u, 3),
+                    c1[s].z + c2[s].z * u + c3[s].z * pow(u, 2) + c4[s].z * pow(u, 3));
+    }
+
+    vec3 GetPosition(float distance) const {
+        distance = std::min(std::max(distance, 0.0f), lengths.back());
+        size_t sample = upper_bound(lengths.begin(), lengths.end(), distance) - lengths.begin();
+        sample = std::min(std::max(sample, (size_t) 1), lengths.size() - 1) - 1;
+        float span = lengths[sample + 1] - lengths[sample];
+        float t = (span > 0.0f) ? (distance - lengths[sample]) / span : 0.0f;
+        return Evaluate(sample / PATH_SAMPLES_PER_SEGMENT,
+                        (sample % PATH_SAMPLES_PER_SEGMENT + t) / PATH_SAMPLES_PER_SEGMENT);
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    int pointCount = (argc > 1) ? atoi(argv[1]) : 1000;
+    int samples = (argc > 2) ? atoi(argv[2]) : 10000;
+
+    // A seeded wandering track
+    vector<vec3> points;
+    uint64_t key = RandomKey(248);
+    vec3 point(0);
+    for (int i = 0; i < pointCount; i++) {
+        point += vec3(RandomFloat(3 * i, key, -1, 1), 1.0f, 0.2f * RandomFloat(3 * i + 1, key, -1, 1));
+        points.push_back(point);
+    }
+
+    SplinePath path(points);
+    LegacyPath legacy(points);
+
+    // Evenly spread samples, as when laying out track geometry
+    vector<float> distances(samples);
+    for (int i = 0; i < samples; i++)
+        distances[i] = path.GetLength() * i / (samples - 1);
+    vector<float> x(samples), y(samples), z(samples);
+
+    cout << "----- Spline path benchmark -----" << endl;
+    cout << " " << path.GetSegmentCount() << " segments, length " << path.GetLength()
+         << ", " << samples << " samples, best of " << REPETITIONS << endl;
+
+    double legacyTime = timeRuns([&]() {
+        for (int i = 0; i < samples; i++) {
+            vec3 p = legacy.GetPosition(distances[i]);
+            x[i] = p.x; y[i] = p.y; z[i] = p.z;
+        }
+    });
+    cout << " Old per-point evaluation:  " << legacyTime * 1e6 / samples << " ns/sample" << endl;
+
+    double scalarTime = timeRuns([&]() {
+        for (int i = 0; i < samples; i++) {
+            vec3 p = path.GetPosition(distances[i]);
+            x[i] = p.x; y[i] = p.y; z[i] = p.z;
+        }
+    });
+    cout << " SplinePath::GetPosition:   " << scalarTime * 1e6 / samples << " ns/sample" << endl;
+
+    double batchTime = timeRuns([&]() { path.GetPositions(&distances[0], &x[0], &y[0], &z[0], samples); });
+    cout << " SplinePath::GetPositions:  " << batchTime * 1e6 / samples << " ns/sample" << endl;
+
+    double directionTime = timeRuns([&]() { path.GetDirections(&distances[0], &x[0], &y[0], &z[0], samples); });
+    cout << " SplinePath::GetDirections: " << directionTime * 1e6 / samples << " ns/sample" << endl;
+
+    // Batched against scalar, and constant speed
+    path.GetPositions(&distances[0], &x[0], &y[0], &z[0], samples);
+    float error = 0, shortest = 1e30f, longest = 0;
+    for (int i = 0; i < samples; i++) {
+        error = std::max(error, length(path.GetPosition(distances[i]) - vec3(x[i], y[i], z[i])));
+        if (i > 0) {
+            float step = length(vec3(x[i] - x[i - 1], y[i] - y[i - 1], z[i] - z[i - 1]));
+            shortest = std::min(shortest, step);
+            longest = std::max(longest, step);
+        }
+    }
+    cout << " Largest batched/scalar difference: " << error << endl;
+    cout << " Step lengths: " << shortest << " to " << longest
+         << " (expected " << path.GetLength() / (samples - 1) << ")" << endl;
+
+    return 0;
+}
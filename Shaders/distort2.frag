@@ -1,5 +1,6 @@
 /* Fragment shader for barrel distortion to cancel out pincushion
- effect of Oculus lens. Includes chromatic abberation fix. */
+ effect of Oculus lens. Includes chromatic abberation fix, and
+ rotational reprojection to the head orientation at present time. */
 
 /* Specifies GLSL version 1.10 - corresponds to OpenGL 2.0 */
 #version 120
@@ -13,8 +14,33 @@ uniform vec2 ScaleIn;
 uniform vec4 HmdWarpParam;
 uniform vec4 ChromAbParam;
 
+// Takes the eye's normalized device coordinates at the present head
+// orientation to those the scene was rendered at
+uniform mat3 Reprojection;
+
+// Where this eye was rendered in the scene: the corner of its half,
+// and the share of the half it covers at the resolution scale
+uniform vec2 SceneOrigin;
+uniform vec2 SceneScale;
+
 varying vec2 texturePosition;
 
+// Moves a texture coordinate in this eye's half of the scene to where
+// the rendered scene shows the same direction
+vec2 reproject(vec2 tc)
+{
+    vec2 ndc = (tc - ScreenCenter) * vec2(4.0, 2.0);
+    vec3 rendered = Reprojection * vec3(ndc, 1.0);
+    return ScreenCenter + rendered.xy / rendered.z * vec2(0.25, 0.5);
+}
+
+// Moves a texture coordinate from the full resolution scene to the
+// part of the texture this eye was rendered to
+vec2 resolve(vec2 tc)
+{
+    return SceneOrigin + (tc - SceneOrigin) * SceneScale;
+}
+
 // Scales input texture coordinates for distortion.
 // ScaleIn maps texture coordinates to Scales to ([-1, 1]), although top/bottom will be
 // larger due to aspect ratio.
@@ -27,7 +53,7 @@ void main()
     
     // Detect whether blue texture coordinates are out of range since these will scaled out the furthest.
     vec2 thetaBlue = theta1 * (ChromAbParam.z + ChromAbParam.w * rSq);
-    vec2 tcBlue = LensCenter + Scale * thetaBlue;
+    vec2 tcBlue = reproject(LensCenter + Scale * thetaBlue);
     if (!all(equal(clamp(tcBlue, ScreenCenter-vec2(0.25,0.5), ScreenCenter+vec2(0.25,0.5)), tcBlue)))
     {
         gl_FragColor = vec4(0);
@@ -35,16 +61,16 @@ void main()
     }
     
     // Now do blue texture lookup.
-    float blue = texture2D(scene, tcBlue).b;
+    float blue = texture2D(scene, resolve(tcBlue)).b;
     
     // Do green lookup (no scaling).
-    vec2  tcGreen = LensCenter + Scale * theta1;
-    vec4  center = texture2D(scene, tcGreen);
+    vec2  tcGreen = reproject(LensCenter + Scale * theta1);
+    vec4  center = texture2D(scene, resolve(tcGreen));
     
     // Do red scale and lookup.
     vec2  thetaRed = theta1 * (ChromAbParam.x + ChromAbParam.y * rSq);
-    vec2  tcRed = LensCenter + Scale * thetaRed;
-    float red = texture2D(scene, tcRed).r;
+    vec2  tcRed = reproject(LensCenter + Scale * thetaRed);
+    float red = texture2D(scene, resolve(tcRed)).r;
     
     gl_FragColor = vec4(red, center.g, blue, 1);
 }
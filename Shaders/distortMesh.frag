@@ -0,0 +1,32 @@
+/* Fragment shader for barrel distortion with a precomputed mesh: one
+   lookup per channel at the coordinates interpolated from the mesh. */
+
+/* Specifies GLSL version 1.10 - corresponds to OpenGL 2.0 */
+#version 120
+
+uniform sampler2D scene;
+
+// Where this eye was rendered in the scene: the corner of its half,
+// and the share of the half it covers at the resolution scale
+uniform vec2 SceneOrigin;
+uniform vec2 SceneScale;
+
+varying vec2 tcRed;
+varying vec2 tcGreen;
+varying vec2 tcBlue;
+
+void main()
+{
+    // Blue is scaled out the furthest, so it leaves the part of the
+    // scene this eye was rendered to first
+    if (any(lessThan(tcBlue, SceneOrigin)) ||
+        any(greaterThan(tcBlue, SceneOrigin + vec2(0.5, 1.0) * SceneScale)))
+    {
+        gl_FragColor = vec4(0);
+        return;
+    }
+    
+    gl_FragColor = vec4(texture2D(scene, tcRed).r,
+                        texture2D(scene, tcGreen).g,
+                        texture2D(scene, tcBlue).b, 1);
+}
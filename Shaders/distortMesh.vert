@@ -0,0 +1,52 @@
+/* Vertex shader for barrel distortion with a precomputed mesh. The
+   warp and chromatic aberration are worked out on the CPU once per
+   vertex (see DistortionMesh), so all that's left here is rotational
+   reprojection to the head orientation at present time. */
+
+/* Specifies GLSL version 1.10 - corresponds to OpenGL 2.0 */
+#version 120
+
+uniform mat4 view;
+uniform vec2 ScreenCenter;
+
+// Takes the eye's normalized device coordinates at the present head
+// orientation to those the scene was rendered at
+uniform mat3 Reprojection;
+
+// Where this eye was rendered in the scene: the corner of its half,
+// and the share of the half it covers at the resolution scale
+uniform vec2 SceneOrigin;
+uniform vec2 SceneScale;
+
+attribute vec4 vertexCoordinates;
+attribute vec2 redCoordinates;
+attribute vec2 greenCoordinates;
+attribute vec2 blueCoordinates;
+
+varying vec2 tcRed;
+varying vec2 tcGreen;
+varying vec2 tcBlue;
+
+// Moves a texture coordinate in this eye's half of the scene to where
+// the rendered scene shows the same direction
+vec2 reproject(vec2 tc)
+{
+    vec2 ndc = (tc - ScreenCenter) * vec2(4.0, 2.0);
+    vec3 rendered = Reprojection * vec3(ndc, 1.0);
+    return ScreenCenter + rendered.xy / rendered.z * vec2(0.25, 0.5);
+}
+
+// Moves a texture coordinate from the full resolution scene to the
+// part of the texture this eye was rendered to
+vec2 resolve(vec2 tc)
+{
+    return SceneOrigin + (tc - SceneOrigin) * SceneScale;
+}
+
+void main()
+{
+    gl_Position = view * vertexCoordinates;
+    tcRed = resolve(reproject(redCoordinates));
+    tcGreen = resolve(reproject(greenCoordinates));
+    tcBlue = resolve(reproject(blueCoordinates));
+}
@@ -0,0 +1,9 @@
+/* Fragment shader for the hidden area mask. Only depth is written. */
+
+/* Specifies GLSL version 1.10 - corresponds to OpenGL 2.0 */
+#version 120
+
+void main()
+{
+    gl_FragColor = vec4(0);
+}
@@ -0,0 +1,14 @@
+/* Vertex shader for the hidden area mask: places the parts of an eye
+   buffer the lens never shows at the near plane, so the depth test
+   rejects the scene there. */
+
+/* Specifies GLSL version 1.10 - corresponds to OpenGL 2.0 */
+#version 120
+
+/* In the eye's viewport, from (0, 0) to (1, 1) */
+attribute vec3 vertexCoordinates;
+
+void main()
+{
+    gl_Position = vec4(vertexCoordinates.xy * 2.0 - 1.0, -1.0, 1.0);
+}
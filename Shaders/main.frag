@@ -85,7 +85,7 @@ void main()
     gl_FragColor = vec4(final_color, 1.0);
     
     if (textured) {
-        gl_FragColor *= texture2D(texture, texturePosition * 50.0);
+        gl_FragColor.rgb *= texture2D(texture, texturePosition * 50.0).r;
     }
     
     if (attenuate) {
@@ -0,0 +1,29 @@
+/* Fragment shader for rendering a normal map from a height map,
+   using central differences. */
+
+/* Specifies GLSL version 1.10 - corresponds to OpenGL 2.0 */
+#version 120
+
+uniform sampler2D heightMap;
+uniform vec2 texelSize;
+uniform float strength;
+
+varying vec2 texturePosition;
+
+/* Fetches the height at an offset (in texels) from this pixel */
+float height(float dx, float dy)
+{
+    return texture2D(heightMap, texturePosition + vec2(dx, dy) * texelSize).r;
+}
+
+void main()
+{
+    // Approximate gradient
+    float dx = (height(1.0, 0.0) - height(-1.0, 0.0)) / 2.0;
+    float dy = (height(0.0, 1.0) - height(0.0, -1.0)) / 2.0;
+    
+    // Normal coordinates can be from -1 to 1
+    // We need to change it to the range 0 to 1
+    vec3 normal = normalize(vec3(-strength * dx, -strength * dy, 1.0));
+    gl_FragColor = vec4(normal * 0.5 + 0.5, 1.0);
+}
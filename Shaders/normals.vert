@@ -0,0 +1,21 @@
+/* Vertex shader for rendering a normal map from a height map
+   with a screen-aligned quad. */
+
+/* Specifies GLSL version 1.10 - corresponds to OpenGL 2.0 */
+#version 120
+
+/* Defined in model space, from (0, 0) to (1, 1) */
+attribute vec3 vertexCoordinates;
+attribute vec2 textureCoordinates;
+
+/* Interpolated texture coordinates */
+varying vec2 texturePosition;
+
+void main()
+{
+    // Map the quad to the whole viewport
+    gl_Position = vec4(2.0 * vertexCoordinates.xy - 1.0, 0, 1);
+    
+    // The quad's texture coordinates are flipped in y
+    texturePosition = vec2(textureCoordinates.x, 1.0 - textureCoordinates.y);
+}
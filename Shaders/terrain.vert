@@ -0,0 +1,66 @@
+/* Vertex shader for streamed terrain tiles (see TerrainStreamer) */
+
+/* Specifies GLSL version 1.10 - corresponds to OpenGL 2.0 */
+#version 120
+#extension GL_EXT_texture_array : enable
+
+/* Must match TILE_WINDOW in Utilities/TerrainStreamer.h */
+#define TILE_WINDOW 5
+
+/* Defined in model space */
+attribute vec3 vertexCoordinates;
+attribute vec3 normalCoordinates;
+attribute vec2 textureCoordinates;
+
+/* MVP information */
+uniform mat4 model;
+uniform mat4 MVP;
+
+/* Interpolated normal, vertex, texture coordinates */
+varying vec3 vertexPosition;
+varying vec3 normalPosition;
+varying vec2 texturePosition;
+
+/* Tile lookup: layer of each tile in the window around the walker
+   (-1 if not uploaded yet), and the window's world space corner */
+uniform sampler2DArray tiles;
+uniform float tileLayers[TILE_WINDOW * TILE_WINDOW];
+uniform vec2 tileOrigin;
+uniform float tileSize;
+uniform float tileResolution;
+
+/* Fetches the terrain height at the given world position */
+float terrainHeight(vec2 position)
+{
+    vec2 tile = floor((position - tileOrigin) / tileSize);
+    tile = clamp(tile, vec2(0.0), vec2(TILE_WINDOW - 1));
+    float layer = tileLayers[int(tile.y) * TILE_WINDOW + int(tile.x)];
+    if (layer < 0.0)
+        return 0.05 * 0.65;
+
+    // Tiles share their edge samples, so texel centers run from the
+    // first to the last sample across the tile
+    vec2 local = (position - tileOrigin) / tileSize - tile;
+    vec2 uv = (local * tileResolution + 0.5) / (tileResolution + 1.0);
+    return 0.05 * texture2DArrayLod(tiles, vec3(uv, layer), 0.0).x;
+}
+
+void main()
+{
+    vec3 position = (model * vec4(vertexCoordinates, 1)).xyz;
+    position.z += terrainHeight(position.xy);
+
+    // Normal from central differences, one sample apart
+    float step = tileSize / tileResolution;
+    float dx = terrainHeight(position.xy + vec2(step, 0)) - terrainHeight(position.xy - vec2(step, 0));
+    float dy = terrainHeight(position.xy + vec2(0, step)) - terrainHeight(position.xy - vec2(0, step));
+    normalPosition = normalize(vec3(-dx, -dy, 2.0 * step));
+
+    vertexPosition = position;
+
+    // Texture coordinates follow the world, matching the fixed grid's mapping
+    texturePosition = position.xy * 0.5 + 0.5;
+
+    // The grid transform is already applied, so only VP is left
+    gl_Position = MVP * vec4(position, 1);
+}
@@ -11,25 +11,110 @@
 #include "../Utilities/Program.h"
 #include "../Utilities/FBO.h"
 #include "../Utilities/Texture.h"
+#include "../Utilities/NormalMap.h"
 #include "../Utilities/Noise.h"
+#include "../Utilities/TerrainStreamer.h"
 #include "../Utilities/OBJFile.h"
 #include "../Utilities/Model.h"
 #include "../Utilities/Screen.h"
+#include "../Utilities/DistortionMesh.h"
+#include "../Utilities/HiddenAreaMesh.h"
+#include "../Utilities/SplinePath.h"
+#include "../Utilities/FrameStats.h"
+#include "../Utilities/Timer.h"
+#include "../Utilities/SimulationClock.h"
+#include "../Utilities/FrameScheduler.h"
+#include "../Utilities/ResolutionScaler.h"
+#include "../Utilities/LatencyTracker.h"
+#include "../Utilities/Profiler.h"
+#include "../Utilities/ResourceRegistry.h"
+#include "../Utilities/ProfilerOverlay.h"
+#include "../Utilities/Trace.h"
+#include "../Utilities/SharedContext.h"
+#include "../Utilities/HeadlessContext.h"
+#include "../Utilities/TripleBuffer.hpp"
+#include "../Utilities/Seqlock.hpp"
+#include "../Utilities/HeightField.hpp"
 #include "../Utilities/bitmap_image.hpp"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/quaternion.hpp>
 
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
 /* Window */
 #define DEFAULT_WIN_WIDTH 1280
 #define DEFAULT_WIN_HEIGHT 880
 
-/* Navigation */
-#define WALKING_SPEED 0.0002f
+/* Build the offscreen benchmark instead of the GLUT app; the
+   Makefile's headless-benchmark target sets this */
+#ifndef HEADLESS
+#define HEADLESS 0
+#endif
+
+/* Navigation (walking speed is in world units per second) */
+#define WALKING_SPEED 0.012f
 #define LOOKING_SPEED 0.005f
 #define WALKING_HEIGHT 0.005f
 
+/* Terrain */
+#define GPU_NORMAL_MAP 0
+#define STREAMING_TERRAIN 0
+
+/* Simulation steps per second, and the most steps run in one frame
+   when catching up after a stall */
+#define SIMULATION_RATE 120
+#define SIMULATION_MAX_STEPS 8
+
+/* Step the walker on its own thread, overlapping the frame's drawing;
+   the benchmark always steps on the window's thread */
+#define SIMULATION_THREAD 1
+
+/* Late latching: re-read the head orientation just before each eye
+   is distorted, and rotate the rendered scene to match */
+#define LATE_LATCH 1
+
+/* Extrapolate the late latched orientation to the blank the frame is
+   shown at, from how fast the head is turning */
+#define ORIENTATION_PREDICTION 1
+
+/* Distort with a mesh whose vertices carry the warped coordinates,
+   instead of working out the warp for every pixel; --distortion=shader
+   or --distortion=mesh chooses at run time */
+#define DISTORTION_MESH 1
+
+/* Mask the parts of the eye buffers the lens never shows in the depth
+   buffer before drawing the scene, so no fragments are shaded there;
+   --no-hidden-area turns it off */
+#define HIDDEN_AREA_MASK 1
+
+/* Dynamic resolution: each frame, scale the eye buffers to keep the
+   GPU's work within RESOLUTION_GPU_BUDGET of the refresh period. The
+   eye targets are made for the largest scale, so changing it never
+   reallocates them; --fixed-resolution keeps the scale at 1. Benchmarks
+   run at a fixed scale, so their times compare, unless given
+   --dynamic-resolution. */
+#define DYNAMIC_RESOLUTION 1
+#define RESOLUTION_MIN_SCALE 0.5f
+#define RESOLUTION_MAX_SCALE 1.25f
+#define RESOLUTION_GPU_BUDGET 0.85
+
+/* Frame pacing (--no-pacing to spin instead); the refresh rate is
+   used when the display's own can't be queried */
+#define DISPLAY_REFRESH_RATE 60
+
+/* Benchmark mode (--benchmark [frames]) */
+#define BENCHMARK_SEED 248
+#define BENCHMARK_FRAMES 2000
+#define BENCHMARK_WARMUP_FRAMES 60
+#define BENCHMARK_PATH_STRIDE 64
+
 /* Unit conversion */
 #define METER_TO_WORLD_UNITS 0.00000000472012046
 
@@ -43,7 +128,12 @@ static int win_height;
 /* Shader variables */
 static Program *mainShader;
 static Program *distortionShader;
+static Program *distortionMeshShader;
+static Program *hiddenAreaShader;
 static Program *screenQuadShader;
+#if STREAMING_TERRAIN
+static Program *terrainShader;
+#endif
 
 static FBO *frameBuffer;
 
@@ -55,8 +145,13 @@ static Texture *noiseField;
 static Texture *rock;
 static Texture *sand;
 
+/* CPU-side terrain heights, for walking */
+static HeightField<float> *terrainHeights;
+
+/* Endless terrain, streamed in tiles around the walker */
+static TerrainStreamer *terrain;
+
 /* OpenGL MVP variables */
-static mat4 projection;
 static mat4 leftProjection;
 static mat4 rightProjection;
 
@@ -72,8 +167,15 @@ static vec3 eyePos;
 static vec3 eyeDir;
 static vec3 eyeLeft;
 static vec3 eyeUp;
+static vec3 eyeVelocity;
 static quat eyeOrientation;
 
+/* When the orientation was read, and how far late latching corrected
+   it (degrees, and ms between the two reads), over a bounded history */
+static Timer orientationAge;
+static FrameStats lateLatchAngles(FRAME_STATS_HISTORY);
+static FrameStats lateLatchIntervals(FRAME_STATS_HISTORY);
+
 float theta, phi;
 
 /* Oculus Rift variables */
@@ -87,12 +189,205 @@ static vec4 chromAbParam;
 /* Movement variables */
 bool mforward, mleft, mright, mbackward;
 
+/* Walker position at the last two simulation steps; frames are drawn
+   in between, so movement looks smooth at any frame rate */
+static SimulationClock simulationClock(1.0 / SIMULATION_RATE, SIMULATION_MAX_STEPS);
+static vec3 previousWalkerPos;
+static vec3 walkerPos;
+
+/* What the walker is told to do: the keys held and the way the head
+   faces. Only the window's thread sees input, so it hands a copy over
+   each frame. */
+struct WalkerInput
+{
+    bool forward, backward, left, right;
+    vec3 direction;
+    vec3 leftward;
+};
+
+/* One simulation step's result, as frames see it. time is when
+   position became current, in milliseconds of runTime. */
+struct WalkerSnapshot
+{
+    double time;
+    vec3 previous;
+    vec3 position;
+    vec3 velocity;
+};
+
+/* Simulation thread: steps the walker at SIMULATION_RATE from the
+   latest input, and publishes a snapshot after each batch of steps.
+   Frames interpolate the newest snapshot and never touch the
+   walker's state. */
+static Timer runTime;
+static std::thread *simulationThread;
+static std::atomic<bool> simulationThreadRunning;
+static Seqlock<WalkerInput> walkerInput;
+static TripleBuffer<WalkerSnapshot> walkerSnapshots;
+static std::atomic<int> snapshotsPublished;
+static int framesReusingSnapshot;
+
 Model *grid;
 Model *sphere;
 Screen *screen;
 
-void render()
+/* Each eye's distortion mesh, rebuilt when its parameters change */
+static bool distortionMesh = DISTORTION_MESH;
+static DistortionMesh *distortionMeshes[2];
+
+/* Each eye's hidden area, as the window's thread draws it; the scene
+   thread keeps its own */
+static bool hiddenAreaMask = HIDDEN_AREA_MASK;
+static HiddenAreaMesh *hiddenAreas[2];
+
+/* Benchmark flythrough: the path, the number of frames to measure
+   (0 when not benchmarking), the current frame and the frame times */
+static SplinePath *benchmarkPath;
+static int benchmarkFrames;
+static int benchmarkFrame;
+static FrameStats frameStats;
+static Timer frameTimer;
+
+/* Fragments the scene's passes let through the depth test, counted
+   over the benchmark with an occlusion query read a frame late */
+static GLuint fragmentQuery;
+static bool fragmentQueryPending;
+static FrameStats sceneFragments;
+
+/* Benchmark times of each profiled pass over the measured frames, and
+   how many of the profiler's frames have been read; --json=<file>
+   saves them with the frame times */
+struct PassTimes
+{
+    PassTimes() : read(0) {}
+    
+    long read;
+    FrameStats cpu[PROFILER_SECTIONS];
+    FrameStats gpu[PROFILER_SECTIONS];
+};
+static PassTimes windowPasses;
+static PassTimes scenePasses;
+static string benchmarkJSON;
+
+/* Paces frames to the display's refresh */
+static FrameScheduler *frameScheduler;
+
+/* Picks the eye buffers' resolution scale from the GPU times of the
+   thread that renders the scene, read as its profiler files them */
+static ResolutionScaler *resolutionScaler;
+static bool dynamicResolution = DYNAMIC_RESOLUTION;
+static const Profiler *resolutionProfiler;
+static long resolutionFramesRead;
+static FrameStats benchmarkScales;
+
+/* Times each frame from sensor to swap; with --latency-limit=<ms>, a
+   benchmark fails if the 95th percentile motion to photon latency is
+   over the limit */
+static LatencyTracker *latency;
+static double latencyLimit;
+
+/* Frame timing by section, for each thread that draws; the overlay
+   ('p') graphs them in the headset, and --profile-csv=<file> saves
+   them on exit */
+static Profiler *windowProfiler;
+static std::atomic<Profiler *> sceneProfiler;
+static ProfilerOverlay *profilerOverlay;
+static bool showProfiler;
+static string profileCSV;
+
+/* A timeline of every thread's work, for chrome://tracing, recorded
+   and saved on exit when --trace=<file> is given */
+static string tracePath;
+
+/* Everything a frame of the scene is rendered from, so it can be
+   handed to another thread in one piece */
+struct SceneState
+{
+    vec3 position;
+    vec3 velocity;
+    quat orientation;
+    vec3 light;
+    mat4 leftProjection;
+    mat4 rightProjection;
+    int width, height;
+    float scale;
+    DistortionParams distortion[2];
+};
+
+/* A finished frame of the scene, with the state it was rendered from.
+   The framebuffer object belongs to the scene thread's context. */
+struct EyeBuffer
+{
+    EyeBuffer() : fbo(NULL), color(NULL), depth(NULL) {}
+    
+    FBO *fbo;
+    Texture *color;
+    Texture *depth;
+    SceneState scene;
+};
+
+/* Asynchronous timewarp (--async-timewarp): a scene thread renders as
+   fast as it can and hands finished frames over; the window's thread
+   distorts the latest one with the latest orientation every refresh */
+static bool asyncTimewarp;
+static std::thread *sceneThread;
+static SharedContext *sceneContext;
+static TripleBuffer<EyeBuffer> eyeBuffers;
+static std::mutex latestSceneMutex;
+static SceneState latestScene;
+static std::atomic<bool> sceneThreadRunning;
+static std::atomic<int> scenesRendered;
+static int framesComposited;
+static int framesReprojected;
+
+#if STREAMING_TERRAIN
+/* Draws the grid displaced by streamed tiles, recentered under the walker */
+void renderStreamedTerrain(const SceneState& scene, const mat4& projection)
+{
+    terrainShader->Use();
+    terrainShader->Reset();
+    
+    // terrain.vert applies the grid transform itself
+    terrainShader->SetUniform("MVP", projection * view);
+    terrainShader->SetUniform("model", terrain->GetGridTransform());
+    
+    // Set up lighting variables
+    terrainShader->SetUniform("illum", 1);
+    terrainShader->SetUniform("attenuate", 1);
+    terrainShader->SetUniform("lightPosition", scene.light);
+    terrainShader->SetUniform("baseColor", vec3(1.00, 0.55, 0.0));
+    
+    // Set up texturing variables
+    terrain->SetUniforms(*terrainShader, GL_TEXTURE0);
+    terrainShader->SetUniform("textured", 1);
+    terrainShader->SetUniform("texture", noiseField, GL_TEXTURE4);
+    
+    // Set up bump mapping variables
+    terrainShader->SetUniform("bumpMapped", 1);
+    terrainShader->SetUniform("sand", sand, GL_TEXTURE2);
+    terrainShader->SetUniform("rock", rock, GL_TEXTURE3);
+    
+    grid->Draw(*terrainShader);
+    
+    terrainShader->Unuse();
+}
+#endif
+
+/* Draws the scene for one eye, with that eye's projection */
+void render(const SceneState& scene, const mat4& projection)
 {
+#if STREAMING_TERRAIN
+    renderStreamedTerrain(scene, projection);
+    
+    // Keep the sky centered on the walker
+    mainShader->Use();
+    mainShader->Reset();
+    
+    mat4 model = glm::translate(mat4(1), vec3(scene.position.x, scene.position.y, 0));
+    mat4 MVP = projection * view * model;
+    mainShader->SetUniform("MVP", MVP);
+    mainShader->SetUniform("model", model);
+#else
     mainShader->Use();
     mainShader->Reset();
     
@@ -104,7 +399,7 @@ void render()
     // Set up lighting variables
     mainShader->SetUniform("illum", 1);
     mainShader->SetUniform("attenuate", 1);
-    mainShader->SetUniform("lightPosition", lightPos);
+    mainShader->SetUniform("lightPosition", scene.light);
     mainShader->SetUniform("baseColor", vec3(1.00, 0.55, 0.0));
     
     // Set up texturing variables
@@ -121,10 +416,11 @@ void render()
     
     // Draw landscape
     grid->Draw(*mainShader);
+#endif
     
     // Set up lighting variables
     mainShader->SetUniform("illum", 1);
-    mainShader->SetUniform("lightPosition", lightPos);
+    mainShader->SetUniform("lightPosition", scene.light);
     mainShader->SetUniform("baseColor", vec3(1.0, 0.80, 0.50));
     
     // Set up texturing variables
@@ -139,12 +435,14 @@ void render()
     mainShader->Unuse();
 }
 
-void updateView()
+void updateView(const SceneState& scene)
 {
+    PROFILE_SCOPE("Update view");
+    
     // Centered view matrix
-    view = glm::lookAt(eyePos,           // Eye
-                       eyePos + eyeDir,  // Apple
-                       eyeUp);           // Up
+    view = glm::lookAt(scene.position,                                   // Eye
+                       scene.position + scene.orientation * vec3(0, 1, 0), // Apple
+                       scene.orientation * vec3(0, 0, 1));               // Up
     
     // View transformation translation in world units.
     if (Oculus::IsInfoLoaded()) {
@@ -201,18 +499,128 @@ void updateDistortion(Viewport& VP)
                         config.ChromaticAberration[3]);
 }
 
-// Render from frame buffer to screen, with barrel distortion for Oculus
-void barrelDistort()
+/* Returns the distortion parameters for an eye's part of the window,
+   for the meshes built from them */
+DistortionParams getDistortionParams(Viewport VP)
 {
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    updateDistortion(VP);
+    DistortionParams params;
+    params.lensCenter = lensCenter;
+    params.screenCenter = screenCenter;
+    params.scale = scaleOut;
+    params.scaleIn = scaleIn;
+    params.warp = hmdWarpParm;
+    params.chromatic = chromAbParam;
+    params.origin = vec2(float(VP.x) / win_width, float(VP.y) / win_height);
+    params.size = vec2(float(VP.w) / win_width, float(VP.h) / win_height);
+    return params;
+}
+
+/* Returns the head orientation from the latest mouse and sensor
+   input, with the sensor extrapolated the given milliseconds ahead */
+quat sampleOrientation(double prediction = 0)
+{
+    quat orientation = normalize(fquat(vec3(0, 0, theta)));
+    if (Oculus::HasOrientation()) {
+        orientation = normalize(orientation * Oculus::GetOrientation(prediction));
+        latency->Mark(LATENCY_SENSOR, Oculus::GetSampleAge());
+    }
+    return orientation;
+}
+
+/* Returns the homography that takes an eye's normalized device
+   coordinates, seen with the present orientation, to where the scene
+   rendered with the given orientation shows the same direction. Only
+   rotation is corrected, which is exact for distant scenery. */
+mat3 reprojection(const mat4& eyeProjection, const quat& rendered, const quat& present)
+{
+    // The projection without depth, taking view directions to (x, y, w)
+    mat3 K(vec3(eyeProjection[0][0], eyeProjection[0][1], eyeProjection[0][3]),
+           vec3(eyeProjection[1][0], eyeProjection[1][1], eyeProjection[1][3]),
+           vec3(eyeProjection[2][0], eyeProjection[2][1], eyeProjection[2][3]));
     
-    distortionShader->Use();
-    distortionShader->Reset();
+    mat3 renderedView(glm::lookAt(vec3(0), rendered * vec3(0, 1, 0), rendered * vec3(0, 0, 1)));
+    mat3 presentView(glm::lookAt(vec3(0), present * vec3(0, 1, 0), present * vec3(0, 0, 1)));
     
-    // Render left
-    glViewport(0, 0, win_width / 2, win_height);
-    struct Viewport left(0, 0, win_width / 2, win_height);
-    updateDistortion(left);
+    return K * renderedView * transpose(presentView) * inverse(K);
+}
+
+/* Reads the orientation again for an eye about to be distorted, and
+   sets the reprojection from the rendered orientation to it */
+void lateLatch(Program *program, const mat4& eyeProjection, const quat& rendered)
+{
+#if LATE_LATCH
+    double prediction = 0;
+#if ORIENTATION_PREDICTION
+    prediction = std::max(frameScheduler->GetTimeToDeadline(), 0.0);
+#endif
+    quat present = sampleOrientation(prediction);
+    float cosine = std::min(std::abs(dot(rendered, present)), 1.0f);
+    lateLatchAngles.Add(degrees(2.0f * acos(cosine)));
+    lateLatchIntervals.Add(orientationAge.GetElapsed());
+#else
+    quat present = rendered;
+#endif
+    program->SetUniform("Reprojection", reprojection(eyeProjection, rendered, present));
+}
+
+/* Returns the size eye targets are made at for a window size: with
+   dynamic resolution, big enough for the largest scale, and even, so
+   the eyes get a half each */
+int eyeTargetSize(int windowSize)
+{
+    if (!dynamicResolution)
+        return windowSize;
+    return ((int) ceil(windowSize * RESOLUTION_MAX_SCALE) + 1) & ~1;
+}
+
+/* Returns the part of an eye target that an eye (0 for left, 1 for
+   right) is rendered to, at the scene's resolution scale */
+Viewport eyeViewport(const SceneState& scene, Texture *target, int eye)
+{
+    int half = (int) target->GetWidth() / 2;
+    int width = std::min((int) (scene.width / 2 * scene.scale + 0.5f), half);
+    int height = std::min((int) (scene.height * scene.scale + 0.5f), (int) target->GetHeight());
+    return Viewport(eye * half, 0, width, height);
+}
+
+/* Sets where in the scene texture an eye was rendered: the corner of
+   its half, and the share of the half it covers at the resolution
+   scale. The distortion shaders work in full resolution coordinates
+   and apply these just before reading the scene. */
+void setSceneRegion(Program *program, const SceneState& scene, Texture *sceneColor, int eye)
+{
+    Viewport VP = eyeViewport(scene, sceneColor, eye);
+    float width = sceneColor->GetWidth(), height = sceneColor->GetHeight();
+    program->SetUniform("SceneOrigin", vec2(VP.x / width, VP.y / height));
+    program->SetUniform("SceneScale", vec2(2 * VP.w / width, VP.h / height));
+}
+
+/* Draws one eye with the distortion mesh, building the mesh first if
+   the window or the HMD has changed since */
+void distortEyeWithMesh(int eye, Viewport& VP, Texture *sceneColor, const SceneState& scene,
+                        const mat4& eyeProjection)
+{
+    DistortionParams params = getDistortionParams(VP);
+    if (!distortionMeshes[eye] || distortionMeshes[eye]->GetParams() != params) {
+        ResourceOwner owner("Distortion mesh");
+        delete distortionMeshes[eye];
+        distortionMeshes[eye] = new DistortionMesh(params);
+    }
+    
+    distortionMeshShader->SetUniform("view", distortionView);
+    distortionMeshShader->SetUniform("ScreenCenter", screenCenter);
+    distortionMeshShader->SetUniform("scene", sceneColor, GL_TEXTURE0);
+    setSceneRegion(distortionMeshShader, scene, sceneColor, eye);
+    lateLatch(distortionMeshShader, eyeProjection, scene.orientation);
+    distortionMeshes[eye]->Draw(*distortionMeshShader);
+}
+
+/* Draws one eye with the warp worked out for every pixel */
+void distortEyeWithShader(int eye, Viewport& VP, Texture *sceneColor, const SceneState& scene,
+                          const mat4& eyeProjection)
+{
+    updateDistortion(VP);
     distortionShader->SetUniform("view", distortionView);
     distortionShader->SetUniform("TM", TM);
     distortionShader->SetUniform("Scale", scaleOut);
@@ -221,59 +629,597 @@ void barrelDistort()
     distortionShader->SetUniform("ScreenCenter", screenCenter);
     distortionShader->SetUniform("HmdWarpParam", hmdWarpParm);
     distortionShader->SetUniform("ChromAbParam", chromAbParam);
-    distortionShader->SetUniform("scene", sceneTexture, GL_TEXTURE0);
+    distortionShader->SetUniform("scene", sceneColor, GL_TEXTURE0);
+    setSceneRegion(distortionShader, scene, sceneColor, eye);
+    lateLatch(distortionShader, eyeProjection, scene.orientation);
     screen->Draw(*distortionShader);
+}
+
+/* Draws both eyes of a rendered scene to the window, with fixing for
+   distortion and chromatic aberration */
+void barrelDistort(Texture *sceneColor, const SceneState& scene)
+{
+    PROFILE_GPU_SCOPE("Distortion");
     
-    // Render right
-    glViewport(win_width / 2, 0, win_width / 2, win_height);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    
+    Program *program = distortionMesh ? distortionMeshShader : distortionShader;
+    program->Use();
+    program->Reset();
+    
+    struct Viewport left(0, 0, win_width / 2, win_height);
     struct Viewport right(win_width / 2, 0, win_width / 2, win_height);
-    updateDistortion(right);
-    distortionShader->SetUniform("view", distortionView);
-    distortionShader->SetUniform("TM", TM);
-    distortionShader->SetUniform("Scale", scaleOut);
-    distortionShader->SetUniform("ScaleIn", scaleIn);
-    distortionShader->SetUniform("LensCenter", lensCenter);
-    distortionShader->SetUniform("ScreenCenter", screenCenter);
-    distortionShader->SetUniform("HmdWarpParam", hmdWarpParm);
-    distortionShader->SetUniform("ChromAbParam", chromAbParam);
-    distortionShader->SetUniform("scene", sceneTexture, GL_TEXTURE0);
-    screen->Draw(*distortionShader);
     
-    distortionShader->Unuse();
+    // Render left
+    glViewport(left.x, left.y, left.w, left.h);
+    if (distortionMesh)
+        distortEyeWithMesh(0, left, sceneColor, scene, scene.leftProjection);
+    else
+        distortEyeWithShader(0, left, sceneColor, scene, scene.leftProjection);
+    
+    // Render right
+    glViewport(right.x, right.y, right.w, right.h);
+    if (distortionMesh)
+        distortEyeWithMesh(1, right, sceneColor, scene, scene.rightProjection);
+    else
+        distortEyeWithShader(1, right, sceneColor, scene, scene.rightProjection);
+    
+    program->Unuse();
 }
 
-void display()
+void reportLateLatch()
+{
+    if (!lateLatchAngles.GetCount())
+        return;
+    cout << "Late latch: corrected a mean of " << lateLatchAngles.GetMean()
+         << " degrees, at most " << lateLatchAngles.GetMax() << " degrees" << endl;
+    lateLatchIntervals.Report("  Orientation read to re-read", cout);
+}
+
+/* Returns the state of the scene as the main thread sees it now */
+SceneState captureScene()
+{
+    SceneState scene;
+    scene.position = eyePos;
+    scene.velocity = eyeVelocity;
+    scene.orientation = eyeOrientation;
+    scene.light = lightPos;
+    scene.leftProjection = leftProjection;
+    scene.rightProjection = rightProjection;
+    scene.width = win_width;
+    scene.height = win_height;
+    scene.scale = resolutionScaler ? resolutionScaler->GetScale() : 1;
+    scene.distortion[0] = getDistortionParams(Viewport(0, 0, win_width / 2, win_height));
+    scene.distortion[1] = getDistortionParams(Viewport(win_width / 2, 0, win_width / 2, win_height));
+    return scene;
+}
+
+/* Returns whether a profiled pass is drawn at the resolution scale;
+   the rest of the GPU's work is the window's size whatever the scale */
+bool isScaledPass(const char *name)
+{
+    return strcmp(name, "Hidden area") == 0 || strcmp(name, "Left eye") == 0
+        || strcmp(name, "Right eye") == 0;
+}
+
+/* Feeds the resolution scaler each frame's GPU time as the profiler
+   files it; without timer queries the scale stays where it is */
+void updateResolutionScale()
+{
+    const Profiler *profiler = sceneThread ? sceneProfiler.load() : windowProfiler;
+    if (!dynamicResolution || !profiler || !profiler->HasGPUTimes())
+        return;
+    if (profiler != resolutionProfiler) {
+        resolutionProfiler = profiler;
+        resolutionFramesRead = profiler->GetFrameCount();
+    }
+    for (long last = profiler->GetFrameCount(); resolutionFramesRead < last; resolutionFramesRead++) {
+        const ProfileFrame& times = profiler->GetFrame(resolutionFramesRead);
+        double scaled = 0, fixed = 0;
+        bool timed = false;
+        for (int section = 0; section < profiler->GetSectionCount(); section++) {
+            if (times.gpu[section] < 0)
+                continue;
+            if (isScaledPass(profiler->GetSectionName(section))) {
+                scaled += times.gpu[section];
+                timed = true;
+            }
+            else {
+                fixed += times.gpu[section];
+            }
+        }
+        if (timed)
+            resolutionScaler->AddFrame(scaled, fixed);
+    }
+}
+
+/* Starts counting the fragments the scene's passes draw, after filing
+   the count from the frame before, which is done by now */
+void beginFragmentCount()
+{
+    if (!fragmentQuery) {
+        glGenQueries(1, &fragmentQuery);
+    }
+    else if (fragmentQueryPending) {
+        GLuint fragments = 0;
+        glGetQueryObjectuiv(fragmentQuery, GL_QUERY_RESULT, &fragments);
+        if (benchmarkFrame >= BENCHMARK_WARMUP_FRAMES)
+            sceneFragments.Add(fragments);
+    }
+    glBeginQuery(GL_SAMPLES_PASSED, fragmentQuery);
+    fragmentQueryPending = true;
+}
+
+/* Writes the parts of the eyes the lens never shows into the depth
+   buffer at the near plane, so the scene's fragments there fail the
+   depth test before they are shaded. Each thread that renders the
+   scene keeps its own meshes, rebuilt when the distortion changes. */
+void maskHiddenAreas(const SceneState& scene, Texture *color, HiddenAreaMesh *meshes[2])
+{
+    if (!hiddenAreaMask)
+        return;
+    PROFILE_GPU_SCOPE("Hidden area");
+    
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    hiddenAreaShader->Use();
+    for (int eye = 0; eye < 2; eye++) {
+        if (!meshes[eye] || meshes[eye]->GetParams() != scene.distortion[eye]) {
+            ResourceOwner owner("Hidden area mesh");
+            delete meshes[eye];
+            meshes[eye] = new HiddenAreaMesh(scene.distortion[eye]);
+            cout << "Hidden area: " << 100 * meshes[eye]->GetHiddenFraction()
+                 << "% of the " << (eye ? "right" : "left") << " eye buffer" << endl;
+        }
+        Viewport VP = eyeViewport(scene, color, eye);
+        glViewport(VP.x, VP.y, VP.w, VP.h);
+        meshes[eye]->Draw(*hiddenAreaShader);
+    }
+    hiddenAreaShader->Unuse();
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+/* Renders both eyes side by side into the given textures, masking
+   what the lens never shows with the given hidden area meshes. With
+   countFragments, the fragments the eyes draw are counted. */
+void renderScene(const SceneState& scene, FBO *fbo, Texture *color, Texture *depth,
+                 HiddenAreaMesh *masks[2], bool countFragments = false)
 {
     // First we fix the view matrices
-    updateView();
+    updateView(scene);
+    
+#if STREAMING_TERRAIN
+    terrain->Update(scene.position, scene.velocity);
+#endif
     
     // Render to frame buffer
-    frameBuffer->Use();
-    frameBuffer->SetDepthTexture(depthTexture);
-    frameBuffer->SetColorTexture(sceneTexture, GL_COLOR_ATTACHMENT0);
-    frameBuffer->SetDrawTarget(GL_COLOR_ATTACHMENT0);
+    fbo->Use();
+    fbo->SetDepthTexture(depth);
+    fbo->SetColorTexture(color, GL_COLOR_ATTACHMENT0);
+    fbo->SetDrawTarget(GL_COLOR_ATTACHMENT0);
     
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    maskHiddenAreas(scene, color, masks);
+    
+    if (countFragments)
+        beginFragmentCount();
     
     // Render left
-    glViewport(0, 0, win_width / 2, win_height);
-    projection = leftProjection;
-    view = leftView;
-    render();
+    {
+        PROFILE_GPU_SCOPE("Left eye");
+        Viewport left = eyeViewport(scene, color, 0);
+        glViewport(left.x, left.y, left.w, left.h);
+        view = leftView;
+        render(scene, scene.leftProjection);
+    }
     
     // Render right
-    glViewport(win_width / 2, 0, win_width / 2, win_height);
-    projection = rightProjection;
-    view = rightView;
-    render();
+    {
+        PROFILE_GPU_SCOPE("Right eye");
+        Viewport right = eyeViewport(scene, color, 1);
+        glViewport(right.x, right.y, right.w, right.h);
+        view = rightView;
+        render(scene, scene.rightProjection);
+    }
+    
+    if (countFragments)
+        glEndQuery(GL_SAMPLES_PASSED);
+    
+    fbo->Unuse();
+}
+
+/* The scene thread: renders the latest state into the back eye buffer
+   and publishes it, until told to stop */
+void runSceneThread()
+{
+    if (!sceneContext->MakeCurrent()) {
+        cerr << "Warning: unable to use the shared context on the scene thread" << endl;
+        return;
+    }
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_TEXTURE_2D);
+    Trace::SetThreadName("scene");
+    
+    // Its timer queries belong to this thread's context
+    Profiler *profiler = new Profiler("scene");
+    Profiler::SetCurrent(profiler);
+    sceneProfiler = profiler;
+    
+    // Its buffers are shared, but it builds its own as the window changes
+    HiddenAreaMesh *masks[2] = { NULL, NULL };
+    
+    while (sceneThreadRunning) {
+        {
+            TRACE_SCOPE("frame", "Scene frame");
+            EyeBuffer& eyes = eyeBuffers.GetBack();
+            {
+                std::lock_guard<std::mutex> lock(latestSceneMutex);
+                eyes.scene = latestScene;
+            }
+            
+            // Buffers are (re)made here, as framebuffer objects can't be
+            // shared; the window's thread never holds the back buffer.
+            // Only the window's size matters, not the resolution scale.
+            int width = eyeTargetSize(eyes.scene.width), height = eyeTargetSize(eyes.scene.height);
+            if (!eyes.color || eyes.color->GetWidth() != width || eyes.color->GetHeight() != height) {
+                ResourceOwner owner("Eye buffers");
+                delete eyes.fbo;
+                delete eyes.color;
+                delete eyes.depth;
+                eyes.fbo = new FBO(width, height);
+                eyes.color = new Texture(width, height, GL_RGBA);
+                eyes.depth = new Texture(width, height, GL_DEPTH_COMPONENT);
+            }
+            
+            renderScene(eyes.scene, eyes.fbo, eyes.color, eyes.depth, masks);
+            
+            // The frame must be complete before the other context reads it
+            {
+                TRACE_SCOPE("sync", "Finish");
+                glFinish();
+            }
+            eyeBuffers.Publish();
+            scenesRendered++;
+            PROFILE_END_FRAME();
+        }
+        
+        // No use rendering frames that will never be shown
+        TRACE_SCOPE("idle", "Wait for composite");
+        while (sceneThreadRunning && eyeBuffers.HasFresh()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    
+    // The framebuffer objects can only be deleted on this context
+    for (int i = 0; i < 3; i++) {
+        delete eyeBuffers[i].fbo;
+        delete eyeBuffers[i].color;
+        delete eyeBuffers[i].depth;
+        eyeBuffers[i] = EyeBuffer();
+    }
+    delete masks[0];
+    delete masks[1];
+    
+    sceneContext->Release();
+}
+
+/* Starts the scene thread, with a context sharing the window's, once
+   the window has a size. Returns false if rendering has to stay on the
+   window's thread. */
+bool startSceneThread()
+{
+#if STREAMING_TERRAIN
+    // Tile streaming touches GL state and its cache from the render
+    // thread and the walker's height lookups at once
+    cerr << "Warning: asynchronous timewarp doesn't support streamed terrain" << endl;
+    return false;
+#endif
+    sceneContext = new SharedContext();
+    if (!sceneContext->IsValid()) {
+        delete sceneContext;
+        sceneContext = NULL;
+        return false;
+    }
     
-    frameBuffer->Unuse();
+    latestScene = captureScene();
+    sceneThreadRunning = true;
+    sceneThread = new std::thread(runSceneThread);
+    return true;
+}
+
+void stopSceneThread()
+{
+    if (!sceneThread)
+        return;
+    sceneThreadRunning = false;
+    sceneThread->join();
+    delete sceneThread;
+    sceneThread = NULL;
+}
+
+/* Distorts the latest finished frame from the scene thread. A frame
+   that is shown again is still reprojected to the latest orientation. */
+void composite()
+{
+    if (!eyeBuffers.Acquire())
+        framesReprojected++;
+    framesComposited++;
     
-    // Render to screen from texture in the framebuffer,
-    // with fixing for distortion and chromatic aberration
-    barrelDistort();
+    EyeBuffer& eyes = eyeBuffers.GetFront();
+    if (!eyes.color) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        return;
+    }
+    barrelDistort(eyes.color, eyes.scene);
+}
+
+void reportTimewarp()
+{
+    if (!framesComposited)
+        return;
+    cout << "Timewarp: " << scenesRendered << " scenes rendered, " << framesComposited
+         << " frames shown, " << framesReprojected << " of them reusing an older scene" << endl;
+}
+
+/* Returns false if motion to photon latency is over the limit */
+bool checkLatency()
+{
+    if (latencyLimit <= 0)
+        return true;
     
-    glutSwapBuffers();
+    const FrameStats& total = latency->GetTotal();
+    if (!total.GetCount()) {
+        cerr << "Latency check failed: no sensor readings (try --hmd=synthetic)" << endl;
+        return false;
+    }
+    double p95 = total.GetPercentile(0.95);
+    if (p95 > latencyLimit) {
+        cerr << "Latency check failed: p95 " << p95 << " ms is over the "
+             << latencyLimit << " ms limit" << endl;
+        return false;
+    }
+    return true;
+}
+
+/* Draws the profiler graphs into the middle of each eye, where the
+   lenses show them sharpest; the scene thread's goes above the
+   window's */
+void drawProfilerOverlay()
+{
+    int width = win_width / 6, height = win_height / 8;
+    for (int eye = 0; eye < 2; eye++) {
+        int x = eye * win_width / 2 + (win_width / 2 - width) / 2;
+        int y = win_height / 2 - height - 4;
+        profilerOverlay->Draw(*windowProfiler, x, y, width, height);
+        if (sceneProfiler)
+            profilerOverlay->Draw(*sceneProfiler, x, y + height + 4, width, height);
+    }
+}
+
+/* Saves the frames the profilers kept, if asked to */
+void writeProfile()
+{
+    if (profileCSV.empty())
+        return;
+    ofstream out(profileCSV.c_str());
+    if (!out) {
+        cerr << "Warning: unable to write the profile to " << profileCSV << endl;
+        return;
+    }
+    windowProfiler->WriteCSV(out);
+    if (sceneProfiler)
+        sceneProfiler.load()->WriteCSV(out, false);
+}
+
+/* Saves the timeline, if one was recorded */
+void writeTrace()
+{
+    if (!tracePath.empty())
+        Trace::Write(tracePath);
+}
+
+/* Reports memory use, frees what the window's thread made, and warns
+   about anything left over; the scene thread frees its own on stopping.
+   'm' prints the totals at any time, and --vram-budget=<MB> warns when
+   the GPU's share goes over. */
+void releaseResources()
+{
+    ResourceRegistry::Report();
+    
+    delete frameBuffer;
+    delete sceneTexture;
+    delete depthTexture;
+    delete heightField;
+    delete normalMap;
+    delete noiseField;
+    delete rock;
+    delete sand;
+    delete grid;
+    delete sphere;
+    delete screen;
+    delete distortionMeshes[0];
+    delete distortionMeshes[1];
+    delete hiddenAreas[0];
+    delete hiddenAreas[1];
+#if STREAMING_TERRAIN
+    delete terrain;
+#endif
+    frameBuffer = NULL;
+    sceneTexture = depthTexture = heightField = normalMap = noiseField = rock = sand = NULL;
+    grid = sphere = NULL;
+    screen = NULL;
+    distortionMeshes[0] = distortionMeshes[1] = NULL;
+    hiddenAreas[0] = hiddenAreas[1] = NULL;
+    terrain = NULL;
+    
+    ResourceRegistry::ReportLeaks();
+}
+
+/* Prints the fragments the scene's passes drew per frame */
+void reportSceneFragments()
+{
+    if (!sceneFragments.GetCount())
+        return;
+    cout << "Scene fragments per frame (hidden area " << (hiddenAreaMask ? "masked" : "not masked")
+         << "): mean " << sceneFragments.GetMean() << ", min " << sceneFragments.GetMin()
+         << ", max " << sceneFragments.GetMax() << endl;
+}
+
+/* Reads the frames a profiler has filed since last time, keeping
+   their pass times once the benchmark's warm up is over */
+void collectPassTimes(const Profiler *profiler, PassTimes& passes)
+{
+    if (!profiler)
+        return;
+    bool measuring = benchmarkFrame >= BENCHMARK_WARMUP_FRAMES;
+    for (long last = profiler->GetFrameCount(); passes.read < last; passes.read++) {
+        const ProfileFrame& times = profiler->GetFrame(passes.read);
+        for (int section = 0; measuring && section < profiler->GetSectionCount(); section++) {
+            if (times.cpu[section] >= 0)
+                passes.cpu[section].Add(times.cpu[section]);
+            if (times.gpu[section] >= 0)
+                passes.gpu[section].Add(times.gpu[section]);
+        }
+    }
+}
+
+/* Writes one profiler's passes as members of the "passes" object */
+void writePassJSON(ostream& out, const Profiler *profiler, const PassTimes& passes, bool& first)
+{
+    if (!profiler)
+        return;
+    for (int section = 0; section < profiler->GetSectionCount(); section++) {
+        if (!passes.cpu[section].GetCount())
+            continue;
+        out << (first ? "" : ",\n") << "    \"" << profiler->GetSectionName(section);
+        if (profiler != windowProfiler)
+            out << " (" << profiler->GetName() << " thread)";
+        out << "\": {\n      \"cpu_ms\": ";
+        passes.cpu[section].WriteJSON(out);
+        if (passes.gpu[section].GetCount()) {
+            out << ",\n      \"gpu_ms\": ";
+            passes.gpu[section].WriteJSON(out);
+        }
+        out << "\n    }";
+        first = false;
+    }
+}
+
+/* Saves the benchmark's frame, pass and latency statistics, if asked to */
+void writeBenchmarkJSON()
+{
+    if (benchmarkJSON.empty())
+        return;
+    ofstream out(benchmarkJSON.c_str());
+    if (!out) {
+        cerr << "Warning: unable to write the benchmark results to " << benchmarkJSON << endl;
+        return;
+    }
+    
+    // Renderer names are plain text, but keep the JSON valid regardless
+    string renderer;
+    for (const char *c = (const char *) glGetString(GL_RENDERER); c && *c; c++) {
+        if (*c != '"' && *c != '\\')
+            renderer += *c;
+    }
+    
+    out << "{\n  \"seed\": " << BENCHMARK_SEED
+        << ",\n  \"frames\": " << frameStats.GetCount()
+        << ",\n  \"width\": " << win_width
+        << ",\n  \"height\": " << win_height
+        << ",\n  \"renderer\": \"" << renderer << "\""
+        << ",\n  \"dynamic_resolution\": " << (dynamicResolution ? "true" : "false")
+        << ",\n  \"resolution_scale\": ";
+    benchmarkScales.WriteJSON(out);
+    out << ",\n  \"frame_ms\": ";
+    frameStats.WriteJSON(out);
+    if (latency->GetTotal().GetCount()) {
+        out << ",\n  \"motion_to_photon_ms\": ";
+        latency->GetTotal().WriteJSON(out);
+    }
+    if (sceneFragments.GetCount()) {
+        out << ",\n  \"scene_fragments\": ";
+        sceneFragments.WriteJSON(out);
+    }
+    out << ",\n  \"passes\": {\n";
+    bool first = true;
+    writePassJSON(out, windowProfiler, windowPasses, first);
+    writePassJSON(out, sceneProfiler, scenePasses, first);
+    out << "\n  }\n}" << endl;
+}
+
+/* Times the frame that was just swapped, and ends the
+   benchmark once enough frames have been measured */
+void recordBenchmarkFrame()
+{
+    double milliseconds = frameTimer.Lap();
+    if (benchmarkFrame >= BENCHMARK_WARMUP_FRAMES) {
+        frameStats.Add(milliseconds);
+        benchmarkScales.Add(resolutionScaler->GetScale());
+    }
+    collectPassTimes(windowProfiler, windowPasses);
+    collectPassTimes(sceneProfiler, scenePasses);
+    benchmarkFrame++;
+    
+    if (benchmarkFrame >= BENCHMARK_WARMUP_FRAMES + benchmarkFrames) {
+        cout << "Benchmark: seed " << BENCHMARK_SEED << ", path length "
+             << benchmarkPath->GetLength() << ", " << win_width << "x" << win_height << endl;
+        frameStats.Report("Frame times");
+        reportSceneFragments();
+        stopSceneThread();
+        
+        // The last frames' GPU times are still out
+        windowProfiler->Flush();
+        collectPassTimes(windowProfiler, windowPasses);
+        collectPassTimes(sceneProfiler, scenePasses);
+        
+        frameScheduler->Report("Frame pacing");
+        resolutionScaler->Report("Resolution scale");
+        reportLateLatch();
+        reportTimewarp();
+        latency->Report();
+        writeProfile();
+        writeTrace();
+        writeBenchmarkJSON();
+        releaseResources();
+        exit(checkLatency() ? 0 : 1);
+    }
+}
+
+void display()
+{
+    TRACE_SCOPE("frame", "Display");
+    updateResolutionScale();
+    if (sceneThread) {
+        composite();
+    }
+    else {
+        SceneState scene = captureScene();
+        renderScene(scene, frameBuffer, sceneTexture, depthTexture, hiddenAreas, benchmarkPath != NULL);
+        barrelDistort(sceneTexture, scene);
+    }
+    
+    if (showProfiler) {
+        drawProfilerOverlay();
+    }
+    
+    frameScheduler->FrameRendered();
+    latency->Submit();
+    {
+        TRACE_SCOPE("sync", "Swap");
+#if HEADLESS
+        // Nothing is shown, but frame times should include the GPU's work
+        glFinish();
+#else
+        glutSwapBuffers();
+#endif
+    }
+    frameScheduler->FrameSwapped();
+    latency->Swap();
+    PROFILE_END_FRAME();
+    
+    if (benchmarkPath) {
+        recordBenchmarkFrame();
+    }
 }
 
 void reshape(int w, int h)
@@ -284,19 +1230,22 @@ void reshape(int w, int h)
     glClearColor(0.0, 0.0, 0.0, 1.0);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
-    // Resize framebuffer
+    ResourceOwner owner("Window targets");
+    
+    // Resize framebuffer, and the scene textures; they are big enough
+    // for the largest resolution scale
+    int width = eyeTargetSize(win_width), height = eyeTargetSize(win_height);
     if (frameBuffer) {
         delete frameBuffer;
     }
-    frameBuffer = new FBO(win_width, win_height);
+    frameBuffer = new FBO(width, height);
     
-    // Resize scene texture
     if (sceneTexture) {
         delete sceneTexture;
         delete depthTexture;
     }
-    sceneTexture = new Texture(win_width, win_height, GL_RGBA);
-    depthTexture = new Texture(win_width, win_height, GL_DEPTH_COMPONENT);
+    sceneTexture = new Texture(width, height, GL_RGBA);
+    depthTexture = new Texture(width, height, GL_DEPTH_COMPONENT);
     
     // Resize viewport
     glViewport(0, 0, w, h);
@@ -304,6 +1253,7 @@ void reshape(int w, int h)
     // Update projections
     glMatrixMode(GL_PROJECTION);
     
+    mat4 projection;
     if (Oculus::IsInfoLoaded()) {
         // Compute Aspect Ratio. Stereo mode cuts width in half.
         float ratio = (float)(Oculus::GetHorizontalResolution() * 0.5f) / Oculus::GetVerticalResolution();
@@ -346,15 +1296,181 @@ void reshape(int w, int h)
     Oculus::UpdateStereoConfig(win_width, win_height);
      
     glMatrixMode(GL_MODELVIEW);
+    
+    // The scene thread needs the window's size for its first frame,
+    // which GLUT gives before the first display
+    if (asyncTimewarp && !sceneThread && !startSceneThread()) {
+        cerr << "Warning: rendering the scene on the window's thread" << endl;
+        asyncTimewarp = false;
+    }
 
+#if !HEADLESS
     glutPostRedisplay();
+#endif
+}
+
+/* x,y from -1.0 to 1.0 */
+float fetchZ(float x, float y)
+{
+#if STREAMING_TERRAIN
+    // Streamed terrain is addressed in world units, with no wrapping
+    return 0.05 * terrain->GetHeight(x, y) + WALKING_HEIGHT;
+#else
+    // Convert from (-1, 1) to (0, 1)
+    x += 1.0;
+    y += 1.0;
+    x /= 2;
+    y /= 2;
+    
+    // Convert to pixel array indices (0 - 600)
+    x *= terrainHeights->GetWidth();
+    y *= terrainHeights->GetHeight();
+    
+    float height = terrainHeights->Sample(x, y);
+    
+    return 0.05 * height + WALKING_HEIGHT;
+#endif
+}
+
+/* Returns the input the walker steps from, as the window's thread sees it now */
+WalkerInput captureInput()
+{
+    WalkerInput input;
+    input.forward = mforward;
+    input.backward = mbackward;
+    input.left = mleft;
+    input.right = mright;
+    input.direction = eyeDir;
+    input.leftward = eyeLeft;
+    return input;
+}
+
+/* Advances the walker by one fixed step of dt seconds */
+void simulate(float dt, const WalkerInput& input)
+{
+    previousWalkerPos = walkerPos;
+    
+    if (input.forward)
+        walkerPos += WALKING_SPEED * dt * input.direction;
+    if (input.backward)
+        walkerPos -= WALKING_SPEED * dt * input.direction;
+    if (input.left)
+        walkerPos += WALKING_SPEED * dt * input.leftward;
+    if (input.right)
+        walkerPos -= WALKING_SPEED * dt * input.leftward;
+    walkerPos.z = fetchZ(walkerPos.x, walkerPos.y);
+}
+
+/* Publishes the walker's last two states, stamped with when the
+   latest one became current */
+void publishWalker(double time)
+{
+    WalkerSnapshot& snapshot = walkerSnapshots.GetBack();
+    snapshot.time = time;
+    snapshot.previous = previousWalkerPos;
+    snapshot.position = walkerPos;
+    snapshot.velocity = (walkerPos - previousWalkerPos) / (float) simulationClock.GetTimestep();
+    walkerSnapshots.Publish();
+    snapshotsPublished++;
+}
+
+/* The simulation thread: runs the steps that are due, publishes
+   them, and sleeps until the next one, until told to stop */
+void runSimulationThread()
+{
+    Trace::SetThreadName("simulation");
+    double timestep = simulationClock.GetTimestep();
+    while (simulationThreadRunning) {
+        double untilNext;
+        {
+            TRACE_SCOPE("simulation", "Simulate");
+            WalkerInput input = walkerInput.Read();
+            int steps = simulationClock.Advance();
+            for (int i = 0; i < steps; i++) {
+                simulate((float) timestep, input);
+            }
+            
+            // The latest step was due the leftover fraction of a step ago
+            untilNext = (1.0 - simulationClock.GetAlpha()) * timestep;
+            if (steps) {
+                publishWalker(runTime.GetElapsed() - (timestep - untilNext) * 1000.0);
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::duration<double>(untilNext));
+    }
+}
+
+/* Hands the walker over to the simulation thread */
+void startSimulationThread()
+{
+    walkerInput.Write(captureInput());
+    publishWalker(runTime.GetElapsed());
+    walkerSnapshots.Acquire();
+    
+    simulationClock = SimulationClock(1.0 / SIMULATION_RATE, SIMULATION_MAX_STEPS);
+    simulationThreadRunning = true;
+    simulationThread = new std::thread(runSimulationThread);
+}
+
+void stopSimulationThread()
+{
+    if (!simulationThread)
+        return;
+    simulationThreadRunning = false;
+    simulationThread->join();
+    delete simulationThread;
+    simulationThread = NULL;
+}
+
+/* Places the camera between the newest snapshot's two states, by how
+   long ago it became current */
+void followWalker()
+{
+    if (!walkerSnapshots.Acquire())
+        framesReusingSnapshot++;
+    const WalkerSnapshot& walker = walkerSnapshots.GetFront();
+    
+    double alpha = (runTime.GetElapsed() - walker.time) / (simulationClock.GetTimestep() * 1000.0);
+    eyePos = mix(walker.previous, walker.position, (float) std::min(std::max(alpha, 0.0), 1.0));
+    eyeVelocity = walker.velocity;
+}
+
+void reportSimulation()
+{
+    if (!snapshotsPublished)
+        return;
+    cout << "Simulation thread: " << snapshotsPublished << " snapshots published, "
+         << simulationClock.GetDroppedSteps() << " steps dropped, " << framesReusingSnapshot
+         << " frames reusing an older snapshot" << endl;
 }
 
 /* GLUT key down callback */
 void keyboard_down(unsigned char key, int x, int y)
 {
+    TRACE_SCOPE("input", "Key down");
     switch(key) {
         case 27:    // Escape key
+            stopSceneThread();
+            stopSimulationThread();
+            frameScheduler->Report("Frame pacing");
+            resolutionScaler->Report("Resolution scale");
+            reportLateLatch();
+            reportTimewarp();
+            reportSimulation();
+            latency->Report();
+            writeProfile();
+            writeTrace();
+#if STREAMING_TERRAIN
+        {
+            const TerrainStreamStats& stats = terrain->GetStats();
+            cout << "Terrain streaming: " << stats.tilesGenerated << " tiles generated, "
+                 << stats.tilesUploaded << " uploaded, " << stats.tilesEvicted << " evicted, "
+                 << stats.cacheBytes / (1024 * 1024) << " MB cached" << endl;
+            cout << "  Worst update " << stats.worstUpdateMs << " ms, " << stats.framesOverBudget
+                 << " of " << stats.frames << " frames over " << TILE_FRAME_BUDGET_MS << " ms" << endl;
+        }
+#endif
+            releaseResources();
             exit(0);
             break;
         case 'a':
@@ -369,6 +1485,12 @@ void keyboard_down(unsigned char key, int x, int y)
         case 'w':
             mforward = true;
             break;
+        case 'p':
+            showProfiler = !showProfiler;
+            break;
+        case 'm':
+            ResourceRegistry::Report();
+            break;
         default:
             break;
     }
@@ -377,6 +1499,7 @@ void keyboard_down(unsigned char key, int x, int y)
 /* GLUT key up callback */
 void keyboard_up(unsigned char key, int x, int y)
 {
+    TRACE_SCOPE("input", "Key up");
     switch(key) {
         case 'a':
             mleft = false;
@@ -398,6 +1521,7 @@ void keyboard_up(unsigned char key, int x, int y)
 
 void mouse(int x, int y)
 {
+    TRACE_SCOPE("input", "Mouse");
     float width = win_width, height = win_height;
     
     if (!Oculus::IsInfoLoaded()) {
@@ -420,50 +1544,106 @@ void mouse(int x, int y)
         phi = -M_PI / 2;
 }
 
-/* x,y from -1.0 to 1.0 */
-float fetchZ(float x, float y)
+/* Builds the benchmark walk from a seeded random path. Every
+   BENCHMARK_PATH_STRIDE-th point becomes a control point, and the
+   path crosses the terrain from one edge to the other, with its
+   sideways wander stretched to cover most of the terrain. */
+SplinePath *makeBenchmarkPath(uint32_t seed)
 {
-    bitmap_image *image = heightField->GetBitmap();
-    
-    // Convert from (-1, 1) to (0, 1)
-    x += 1.0;
-    y += 1.0;
-    x /= 2;
-    y /= 2;
-    
-    // Convert to pixel array indices (0 - 600)
-    x *= image->width();
-    y *= image->height();
+    float *path = pathGen(seed);
+    float low = path[0], high = path[0];
+    for (int i = 0; i < PATH_SIZE; i += BENCHMARK_PATH_STRIDE) {
+        low = std::min(low, path[i]);
+        high = std::max(high, path[i]);
+    }
     
-    float height = image->get_interpolated_height(x, y);
+    vector<vec3> points;
+    for (int i = 0; i < PATH_SIZE; i += BENCHMARK_PATH_STRIDE) {
+        float x = (high > low) ? 1.6f * (path[i] - low) / (high - low) - 0.8f : 0.0f;
+        float y = 2 * (float) i / PATH_SIZE - 1;
+        points.push_back(vec3(x, y, 0));
+    }
+    delete[] path;
+    return new SplinePath(points);
+}
+
+/* Moves the camera along the benchmark path. The distance covered
+   only depends on the frame number, so every run takes the same walk
+   at a constant speed. */
+void followBenchmarkPath()
+{
+    float distance = benchmarkPath->GetLength() * benchmarkFrame
+                   / (BENCHMARK_WARMUP_FRAMES + benchmarkFrames);
+    vec3 position = benchmarkPath->GetPosition(distance);
+    vec3 direction = benchmarkPath->GetDirection(distance);
     
-    return 0.05 * height + WALKING_HEIGHT;
+    eyePos.x = position.x;
+    eyePos.y = position.y;
+    theta = atan2(-direction.x, direction.y);
+    phi = 0;
 }
 
 void animate()
 {
+    // Sleep until the latest time the frame can start, so input is
+    // as fresh as possible when it is drawn
+    {
+        TRACE_SCOPE("idle", "Wait for frame");
+        frameScheduler->WaitForFrame();
+    }
+    TRACE_SCOPE("frame", "Animate");
+    
+    latency->Mark(LATENCY_SIMULATION);
+    
     // Move
-    if (mforward)
-        eyePos += WALKING_SPEED * eyeDir;
-    if (mbackward)
-        eyePos -= WALKING_SPEED * eyeDir;
-    if (mleft)
-        eyePos += WALKING_SPEED * eyeLeft;
-    if (mright)
-        eyePos -= WALKING_SPEED * eyeLeft;
-    eyePos.z = fetchZ(eyePos.x, eyePos.y);
+    if (benchmarkPath) {
+        followBenchmarkPath();
+        eyePos.z = fetchZ(eyePos.x, eyePos.y);
+        previousWalkerPos = walkerPos = eyePos;
+    }
+    else if (simulationThread) {
+        followWalker();
+    }
+    else {
+        int steps = simulationClock.Advance();
+        float dt = (float) simulationClock.GetTimestep();
+        WalkerInput input = captureInput();
+        for (int i = 0; i < steps; i++) {
+            simulate(dt, input);
+        }
+        eyePos = mix(previousWalkerPos, walkerPos, simulationClock.GetAlpha());
+        
+        // Velocity over the last step, so terrain can be streamed in
+        // ahead of the walker
+        eyeVelocity = (walkerPos - previousWalkerPos) / dt;
+    }
     
-    // Update camera (view vectors)
-    eyeOrientation = normalize(fquat(vec3(0, 0, theta)));
-    if (Oculus::IsInfoLoaded()) {
-        eyeOrientation = normalize(eyeOrientation * Oculus::GetOrientation());
+#if STREAMING_TERRAIN
+    // The light travels with the walker
+    lightPos = vec3(eyePos.x, eyePos.y, 1.5);
+#endif
+    
+    // Update camera (view vectors). Looking around is not simulated,
+    // so it responds to the latest input every frame.
+    eyeOrientation = sampleOrientation();
+    orientationAge.Start();
+    
+    if (sceneThread) {
+        std::lock_guard<std::mutex> lock(latestSceneMutex);
+        latestScene = captureScene();
     }
     eyeUp = normalize(eyeOrientation * vec3(0, 0, 1));
     eyeDir = normalize(eyeOrientation * vec3(0, 1, 0));
     eyeLeft = normalize(eyeOrientation * vec3(-1, 0, 0));
     
-    // Redraw
+    if (simulationThread) {
+        walkerInput.Write(captureInput());
+    }
+    
+    // Redraw; frames come at the display rate whatever the simulation rate
+#if !HEADLESS
     glutPostRedisplay();
+#endif
 }
 
 void initGlobals()
@@ -471,8 +1651,13 @@ void initGlobals()
     // Initialize shaders
     mainShader = new Program("Shaders/main.vert", "Shaders/main.frag");
     distortionShader = new Program("Shaders/distort.vert", "Shaders/distort2.frag");
+    distortionMeshShader = new Program("Shaders/distortMesh.vert", "Shaders/distortMesh.frag");
+    hiddenAreaShader = new Program("Shaders/hiddenArea.vert", "Shaders/hiddenArea.frag");
     screenQuadShader = new Program("Shaders/quad.vert", "Shaders/quad.frag");
     
+    resolutionScaler = new ResolutionScaler(frameScheduler->GetPeriod() * RESOLUTION_GPU_BUDGET,
+                                            RESOLUTION_MIN_SCALE, RESOLUTION_MAX_SCALE);
+    
     // Initialize camera, lighting
     eyeOrientation = fquat();
     eyePos = vec3(0, 0, 0);
@@ -482,46 +1667,264 @@ void initGlobals()
     lightPos = vec3(0.0, 0.0, 1.5);
     
     // Initialie textures
-    rock = new Texture("Textures/rock.bmp");
-    sand = new Texture("Textures/sand.bmp");
-    heightField = new Texture("Textures/mars.bmp");
-    normalMap = heightField->GetNormalMap();
-    noiseField = new Noise();
+    rock = new Texture("Textures/rock.bmp", GL_RGB8);
+    sand = new Texture("Textures/sand.bmp", GL_RGB8);
+    heightField = new Texture("Textures/mars.bmp", GL_R8);
+    terrainHeights = new HeightField<float>(heightField->GetBitmap());
+    {
+        ResourceOwner owner("Normal map");
+#if GPU_NORMAL_MAP
+        normalMap = new NormalMap(heightField);
+#else
+        normalMap = new NormalMap(*terrainHeights);
+#endif
+    }
+    {
+        ResourceOwner owner("Noise");
+        noiseField = new Noise();
+    }
+    
+#if STREAMING_TERRAIN
+    terrainShader = new Program("Shaders/terrain.vert", "Shaders/main.frag");
+    terrain = new TerrainStreamer(NOISE_SEED, eyePos);
+#endif
     
     // Load models
-    OBJFile obj("Models/grid.obj");
-    grid = obj.GenModel();
+    {
+        ResourceOwner owner("Models/grid.obj");
+        OBJFile obj("Models/grid.obj");
+        grid = obj.GenModel();
+    }
+    {
+        ResourceOwner owner("Models/icosphere.obj");
+        OBJFile sph("Models/icosphere.obj");
+        sphere = sph.GenModel();
+    }
+    {
+        ResourceOwner owner("Screen quad");
+        screen = new Screen();
+    }
     
-    OBJFile sph("Models/icosphere.obj");
-    sphere = sph.GenModel();
+    if (benchmarkFrames) {
+        benchmarkPath = makeBenchmarkPath(BENCHMARK_SEED);
+    }
     
-    screen = new Screen();
+    // Start the walker on the ground
+    eyePos.z = fetchZ(eyePos.x, eyePos.y);
+    previousWalkerPos = walkerPos = eyePos;
 }
 
+void reportTextureMemory()
+{
+    cout << "Texture memory:" << endl;
+    heightField->ReportMemory("Height map");
+    normalMap->ReportMemory("Normal map");
+    noiseField->ReportMemory("Noise");
+    rock->ReportMemory("Rock");
+    sand->ReportMemory("Sand");
+}
+
+#if HEADLESS
+
+/* The benchmark walk, drawn offscreen at a set size on a context with
+   no window, so renderer performance can be tracked on machines with
+   no display or GPU. Results go to benchmark.json unless --json= says
+   otherwise. */
+int main(int argc, char * argv[])
+{
+    int width = DEFAULT_WIN_WIDTH, height = DEFAULT_WIN_HEIGHT;
+    string hmdBackend = "synthetic";
+    benchmarkFrames = BENCHMARK_FRAMES;
+    benchmarkJSON = "benchmark.json";
+    dynamicResolution = false;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--frames=", 9) == 0) {
+            benchmarkFrames = std::max(atoi(argv[i] + 9), 1);
+        }
+        else if (strncmp(argv[i], "--size=", 7) == 0) {
+            if (sscanf(argv[i] + 7, "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+                cerr << "Error: --size takes WIDTHxHEIGHT" << endl;
+                return 1;
+            }
+        }
+        else if (strncmp(argv[i], "--hmd=", 6) == 0) {
+            hmdBackend = argv[i] + 6;
+        }
+        else if (strncmp(argv[i], "--latency-limit=", 16) == 0) {
+            latencyLimit = atof(argv[i] + 16);
+        }
+        else if (strncmp(argv[i], "--profile-csv=", 14) == 0) {
+            profileCSV = argv[i] + 14;
+        }
+        else if (strncmp(argv[i], "--trace=", 8) == 0) {
+            tracePath = argv[i] + 8;
+        }
+        else if (strncmp(argv[i], "--vram-budget=", 14) == 0) {
+            ResourceRegistry::SetBudget((size_t) (atof(argv[i] + 14) * 1024 * 1024));
+        }
+        else if (strncmp(argv[i], "--json=", 7) == 0) {
+            benchmarkJSON = argv[i] + 7;
+        }
+        else if (strncmp(argv[i], "--distortion=", 13) == 0) {
+            distortionMesh = strcmp(argv[i] + 13, "shader") != 0;
+        }
+        else if (strcmp(argv[i], "--fixed-resolution") == 0) {
+            dynamicResolution = false;
+        }
+        else if (strcmp(argv[i], "--dynamic-resolution") == 0) {
+            dynamicResolution = true;
+        }
+        else if (strcmp(argv[i], "--no-hidden-area") == 0) {
+            hiddenAreaMask = false;
+        }
+    }
+    
+    if (!tracePath.empty()) {
+        Trace::SetThreadName("window");
+        Trace::Start();
+    }
+    
+    HeadlessContext context(width, height);
+    if (!context.IsValid()) {
+        cerr << "Error: unable to create an offscreen OpenGL context" << endl;
+        return 1;
+    }
+#ifndef __APPLE__
+    glewExperimental = GL_TRUE;
+    if (glewInit() != GLEW_OK) {
+        cerr << "Error: unable to load the OpenGL entry points" << endl;
+        return 1;
+    }
+#endif
+    cout << "Renderer: " << glGetString(GL_RENDERER) << endl;
+    
+    frameScheduler = new FrameScheduler(DISPLAY_REFRESH_RATE, false);
+    
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_TEXTURE_2D);
+    
+    // The synthetic display gives the distortion pass the Rift's optics
+    Oculus::Init(hmdBackend);
+    Oculus::Output();
+    
+    initGlobals();
+    latency = new LatencyTracker();
+    windowProfiler = new Profiler("window");
+    Profiler::SetCurrent(windowProfiler);
+    profilerOverlay = new ProfilerOverlay(frameScheduler->GetPeriod());
+    reshape(width, height);
+    
+    // The last frame reports and exits
+    for (;;) {
+        animate();
+        display();
+    }
+}
+
+#else
+
 int main(int argc, char * argv[])
 {
     // Glut init
+    SharedContext::InitThreads();
     glutInit(&argc, argv);
+    
+    bool pacing = true, askedForDynamicResolution = false;
+    string hmdBackend, hmdRecording;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--benchmark") == 0) {
+            benchmarkFrames = BENCHMARK_FRAMES;
+            if (i + 1 < argc && isdigit(argv[i + 1][0]))
+                benchmarkFrames = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--no-pacing") == 0) {
+            pacing = false;
+        }
+        else if (strncmp(argv[i], "--hmd=", 6) == 0) {
+            hmdBackend = argv[i] + 6;
+        }
+        else if (strncmp(argv[i], "--record-hmd=", 13) == 0) {
+            hmdRecording = argv[i] + 13;
+        }
+        else if (strncmp(argv[i], "--latency-limit=", 16) == 0) {
+            latencyLimit = atof(argv[i] + 16);
+        }
+        else if (strcmp(argv[i], "--async-timewarp") == 0) {
+            asyncTimewarp = true;
+        }
+        else if (strncmp(argv[i], "--profile-csv=", 14) == 0) {
+            profileCSV = argv[i] + 14;
+        }
+        else if (strncmp(argv[i], "--trace=", 8) == 0) {
+            tracePath = argv[i] + 8;
+        }
+        else if (strncmp(argv[i], "--vram-budget=", 14) == 0) {
+            ResourceRegistry::SetBudget((size_t) (atof(argv[i] + 14) * 1024 * 1024));
+        }
+        else if (strncmp(argv[i], "--json=", 7) == 0) {
+            benchmarkJSON = argv[i] + 7;
+        }
+        else if (strncmp(argv[i], "--distortion=", 13) == 0) {
+            distortionMesh = strcmp(argv[i] + 13, "shader") != 0;
+        }
+        else if (strcmp(argv[i], "--fixed-resolution") == 0) {
+            dynamicResolution = false;
+        }
+        else if (strcmp(argv[i], "--dynamic-resolution") == 0) {
+            dynamicResolution = askedForDynamicResolution = true;
+        }
+        else if (strcmp(argv[i], "--no-hidden-area") == 0) {
+            hiddenAreaMask = false;
+        }
+    }
+    
+    // Benchmarks compare from run to run only at the same scale
+    if (benchmarkFrames && !askedForDynamicResolution)
+        dynamicResolution = false;
+    
+    if (!tracePath.empty()) {
+        Trace::SetThreadName("window");
+        Trace::Start();
+    }
+    
     glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH);
     glutInitWindowSize(DEFAULT_WIN_WIDTH, DEFAULT_WIN_HEIGHT);
     glutCreateWindow("A Walk on Mars");
     glutPositionWindow(0, 0);
     glutFullScreen();
     
+    double refreshRate = DISPLAY_REFRESH_RATE;
+#ifdef __APPLE__
+    CGDisplayModeRef mode = CGDisplayCopyDisplayMode(CGMainDisplayID());
+    if (mode) {
+        // Built-in panels report 0
+        if (CGDisplayModeGetRefreshRate(mode) > 0)
+            refreshRate = CGDisplayModeGetRefreshRate(mode);
+        CGDisplayModeRelease(mode);
+    }
+#endif
+    // The benchmark measures how fast frames can be drawn, so it never waits
+    frameScheduler = new FrameScheduler(refreshRate, pacing && !benchmarkFrames);
+    
     // Register callback functions
     glutDisplayFunc(display);
     glutReshapeFunc(reshape);
     glutKeyboardFunc(keyboard_down);
     glutKeyboardUpFunc(keyboard_up);
     glutIdleFunc(animate);
-    glutPassiveMotionFunc(mouse);
+    
+    // The benchmark steers the camera itself
+    if (!benchmarkFrames)
+        glutPassiveMotionFunc(mouse);
     
     // Enable the necessary goodies
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_TEXTURE_2D);
     
     // Oculus init
-    Oculus::Init();
+    Oculus::Init(hmdBackend);
+    if (!hmdRecording.empty())
+        Oculus::Record(hmdRecording);
     Oculus::Output();
     
 #ifdef __APPLE__
@@ -529,6 +1932,16 @@ int main(int argc, char * argv[])
 #endif
     
     initGlobals();
+    reportTextureMemory();
+    latency = new LatencyTracker();
+    windowProfiler = new Profiler("window");
+    Profiler::SetCurrent(windowProfiler);
+    profilerOverlay = new ProfilerOverlay(frameScheduler->GetPeriod());
+    
+#if SIMULATION_THREAD
+    if (!benchmarkFrames)
+        startSimulationThread();
+#endif
     
     glutMainLoop();
     
@@ -537,3 +1950,4 @@ int main(int argc, char * argv[])
     return 0;
 }
 
+#endif
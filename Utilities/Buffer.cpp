@@ -1,4 +1,5 @@
 #include "Buffer.h"
+#include "ResourceRegistry.h"
 
 #include <climits>
 #include <iostream>
@@ -26,6 +27,7 @@ Buffer::~Buffer(void)
 void Buffer::Delete()
 {
     glDeleteBuffers(1, &id);
+    ResourceRegistry::Remove(RESOURCE_BUFFER, id);
     valid = false;
 }
 
@@ -57,12 +59,15 @@ DataBuffer<T>::DataBuffer(const std::vector<T>& data, GLenum target)
 	if(is_same_type<T, float>::value) {
 		dataType = GL_FLOAT;
 		glBufferData(target, data.size() * 4, &data[0], GL_STATIC_DRAW);
+		ResourceRegistry::Add(RESOURCE_BUFFER, id, data.size() * 4, "FLOAT");
 	} else if (is_same_type<T, vec2>::value) {
 		dataType = GL_FLOAT;
 		glBufferData(target, data.size() * sizeof(vec2), &data[0], GL_STATIC_DRAW);
+		ResourceRegistry::Add(RESOURCE_BUFFER, id, data.size() * sizeof(vec2), "VEC2");
 	} else if (is_same_type<T, vec3>::value) {
 		dataType = GL_FLOAT;
 		glBufferData(target, data.size() * sizeof(vec3), &data[0], GL_STATIC_DRAW);
+		ResourceRegistry::Add(RESOURCE_BUFFER, id, data.size() * sizeof(vec3), "VEC3");
 	} else {
 		cerr << "Warning: Unknown data type passed to DataBuffer" << endl;
 	}
@@ -81,16 +86,19 @@ DataBuffer<size_t>::DataBuffer(const std::vector<size_t>& data, GLenum target)
 		dataType = GL_UNSIGNED_BYTE;
 		GLubyte *arr = toArr<size_t, GLubyte>(data);
 		glBufferData(target, data.size(), arr, GL_STATIC_DRAW);
+		ResourceRegistry::Add(RESOURCE_BUFFER, id, data.size(), "UBYTE");
 		delete[] arr;
 	} else if (data.size() <= USHRT_MAX) {
 		dataType = GL_UNSIGNED_SHORT;
 		GLushort *arr = toArr<size_t, GLushort>(data);
 		glBufferData(target, data.size() * 2, arr, GL_STATIC_DRAW);
+		ResourceRegistry::Add(RESOURCE_BUFFER, id, data.size() * 2, "USHORT");
 		delete[] arr;
 	} else {
 		dataType = GL_UNSIGNED_INT;
 		GLuint *arr = toArr<size_t, GLuint>(data);
 		glBufferData(target, data.size() * 4, arr, GL_STATIC_DRAW);
+		ResourceRegistry::Add(RESOURCE_BUFFER, id, data.size() * 4, "UINT");
 		delete[] arr;
 	}
 }
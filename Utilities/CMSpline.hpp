@@ -29,28 +29,26 @@ public:
         GenConstants(v1, v2, v3, v4);
     }
     
-    /** Evaluation function. Expects a parameter 'u' between 0 and 1. */
+    /** Evaluation function. Expects a parameter 'u' between 0 and 1.
+        Uses Horner's rule; see SplinePath for chains of segments and
+        batched evaluation. */
     
-    float evaluate(float u) {
-        return c1 + c2 * u + c3 * pow(u, 2) + c4 * pow(u, 3);
+    float evaluate(float u) const {
+        return ((c4 * u + c3) * u + c2) * u + c1;
     }
     
-    float tangent(float u) {
-        return c2 + 2 * c3 * u + 3 * c4 * pow(u, 2);
+    float tangent(float u) const {
+        return (3 * c4 * u + 2 * c3) * u + c2;
     }
     
     /** Will be useful for aligning the camera */
-    glm::vec3 tangent3D(float u) {
-        glm::vec3 tangent = glm::vec3(v2.x + 2 * v3.x * u + 3 * v4.x * pow(u, 2),
-                                 v2.y + 2 * v3.y * u + 3 * v4.y * pow(u, 2),
-                                 v2.z + 2 * v3.z * u + 3 * v4.z * pow(u, 2));
+    glm::vec3 tangent3D(float u) const {
+        glm::vec3 tangent = (3.0f * v4 * u + 2.0f * v3) * u + v2;
         return glm::normalize(tangent);
     }
     
-    glm::vec3 evaluate3D(float u) {
-        return glm::vec3(v1.x + v2.x * u + v3.x * pow(u, 2) + v4.x * pow(u, 3),
-                         v1.y + v2.y * u + v3.y * pow(u, 2) + v4.y * pow(u, 3),
-                         v1.z + v2.z * u + v3.z * pow(u, 2) + v4.z * pow(u, 3));
+    glm::vec3 evaluate3D(float u) const {
+        return ((v4 * u + v3) * u + v2) * u + v1;
     }
     
 private:
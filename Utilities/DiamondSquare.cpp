@@ -0,0 +1,112 @@
+#include "DiamondSquare.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "Random.h"
+
+/* Rows of squares per task when splitting a step across threads */
+#define ROWS_PER_TASK 4
+
+using namespace std;
+
+/** Identifies a sample to the random number generator. Every sample
+    is written exactly once, so its coordinates are enough. */
+static inline uint64_t counterAt(int x, int y)
+{
+    return ((uint64_t) (uint32_t) y << 32) | (uint32_t) x;
+}
+
+void GenerateDiamondSquare(float *map, int size, int featureSize,
+                           uint32_t seed, ThreadPool& pool)
+{
+    const uint64_t key = RandomKey(seed);
+    const int mask = size - 1;
+    featureSize = min(featureSize, size);
+
+    // Seed one random sample per feature
+    for (int y = 0; y < size; y += featureSize) {
+        for (int x = 0; x < size; x += featureSize) {
+            map[y * size + x] = RandomFloat(counterAt(x, y), key, -1.0f, 1.0f);
+        }
+    }
+
+    float scale = 1.0f;
+    for (int squareSize = featureSize; squareSize > 1; squareSize /= 2) {
+        const int half = squareSize / 2;
+        const size_t rows = size / squareSize;
+
+        // Square step: the center of each square, from its corners
+        pool.ParallelFor(rows, ROWS_PER_TASK, [=](size_t begin, size_t end) {
+            for (size_t row = begin; row < end; row++) {
+                int y = half + (int) row * squareSize;
+                const float *above = map + (size_t) ((y - half) & mask) * size;
+                const float *below = map + (size_t) ((y + half) & mask) * size;
+                float *center = map + (size_t) y * size;
+
+                for (int x = half; x < size; x += squareSize) {
+                    int left = (x - half) & mask;
+                    int right = (x + half) & mask;
+                    float value = above[left] + above[right] + below[left] + below[right];
+                    center[x] = value / 4.0f + scale * RandomFloat(counterAt(x, y), key, -1.0f, 1.0f);
+                }
+            }
+        });
+
+        // Diamond step: the midpoint of each square's left and top edges,
+        // from the neighbouring corners and centers
+        pool.ParallelFor(rows, ROWS_PER_TASK, [=](size_t begin, size_t end) {
+            for (size_t row = begin; row < end; row++) {
+                int y = half + (int) row * squareSize;
+
+                // Left edges lie on the centers' row
+                const float *above = map + (size_t) ((y - half) & mask) * size;
+                const float *below = map + (size_t) ((y + half) & mask) * size;
+                float *middle = map + (size_t) y * size;
+                for (int x = 0; x < size; x += squareSize) {
+                    float value = above[x] + below[x] + middle[(x - half) & mask] + middle[x + half];
+                    middle[x] = value / 4.0f + scale * RandomFloat(counterAt(x, y), key, -1.0f, 1.0f);
+                }
+
+                // Top edges lie on the corners' row
+                int top = y - half;
+                const float *centersAbove = map + (size_t) ((top - half) & mask) * size;
+                const float *centersBelow = middle;
+                float *corners = map + (size_t) top * size;
+                for (int x = half; x < size; x += squareSize) {
+                    float value = centersAbove[x] + centersBelow[x] + corners[x - half] + corners[(x + half) & mask];
+                    corners[x] = value / 4.0f + scale * RandomFloat(counterAt(x, top), key, -1.0f, 1.0f);
+                }
+            }
+        });
+
+        scale /= 2.0f;
+    }
+}
+
+void NormalizeDiamondSquare(float *map, int size, ThreadPool& pool)
+{
+    const size_t count = (size_t) size * size;
+    const size_t chunk = 1 << 16;
+
+    // Per-chunk maxima, combined afterwards, so the result does
+    // not depend on how the chunks were scheduled
+    vector<float> maxima((count + chunk - 1) / chunk, 0.0f);
+    pool.ParallelFor(count, chunk, [&](size_t begin, size_t end) {
+        float max = 0.0f;
+        for (size_t i = begin; i < end; i++) {
+            map[i] += 1.0f;
+            max = std::max(max, map[i]);
+        }
+        maxima[begin / chunk] = max;
+    });
+    float max = *max_element(maxima.begin(), maxima.end());
+
+    pool.ParallelFor(count, chunk, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            map[i] /= max;
+            map[i] *= 0.1f;
+            map[i] += 0.6f;
+        }
+    });
+}
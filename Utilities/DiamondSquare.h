@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ThreadPool.h"
+
+/** Random terrain generation with the diamond square algorithm.
+
+    Random offsets come from a counter-based generator keyed by the seed
+    and each sample's coordinates, and every square and diamond step only
+    reads samples finished by earlier steps. So the steps are split
+    across the thread pool freely, and a seed always produces the same
+    map, bit for bit, whatever the number of threads.
+
+    The map wraps around at its edges. Size and feature size must be
+    powers of 2. */
+void GenerateDiamondSquare(float *map, int size, int featureSize,
+                           uint32_t seed, ThreadPool& pool);
+
+/** Rescales a generated map into the range the terrain shaders expect
+    (roughly 0.6 to 0.7) */
+void NormalizeDiamondSquare(float *map, int size, ThreadPool& pool);
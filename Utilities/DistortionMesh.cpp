@@ -0,0 +1,107 @@
+#include "DistortionMesh.h"
+
+#include <vector>
+
+using namespace std;
+using namespace glm;
+
+bool DistortionParams::operator==(const DistortionParams& other) const
+{
+    return lensCenter == other.lensCenter && screenCenter == other.screenCenter
+        && scale == other.scale && scaleIn == other.scaleIn
+        && warp == other.warp && chromatic == other.chromatic
+        && origin == other.origin && size == other.size;
+}
+
+/** The grid's vertices, from (0, 0) to (1, 1) across the viewport */
+static vector<vec3> gridPositions()
+{
+    vector<vec3> positions;
+    for (int row = 0; row <= DISTORTION_MESH_ROWS; row++) {
+        for (int column = 0; column <= DISTORTION_MESH_COLUMNS; column++) {
+            positions.push_back(vec3(column / (float) DISTORTION_MESH_COLUMNS,
+                                     row / (float) DISTORTION_MESH_ROWS, 0));
+        }
+    }
+    return positions;
+}
+
+/** Two triangles per cell */
+static vector<size_t> gridIndices()
+{
+    vector<size_t> indices;
+    size_t stride = DISTORTION_MESH_COLUMNS + 1;
+    for (int row = 0; row < DISTORTION_MESH_ROWS; row++) {
+        for (int column = 0; column < DISTORTION_MESH_COLUMNS; column++) {
+            size_t corner = row * stride + column;
+            indices.push_back(corner);
+            indices.push_back(corner + 1);
+            indices.push_back(corner + stride);
+            indices.push_back(corner + 1);
+            indices.push_back(corner + stride + 1);
+            indices.push_back(corner + stride);
+        }
+    }
+    return indices;
+}
+
+/** Where each channel is read from for every vertex; the same sums
+    distort2.frag does for every pixel */
+static void warpGrid(const DistortionParams& params, const vector<vec3>& positions,
+                     vector<vec2>& red, vector<vec2>& green, vector<vec2>& blue)
+{
+    const vec4& K = params.warp;
+    const vec4& C = params.chromatic;
+    for (size_t i = 0; i < positions.size(); i++) {
+        // The viewport position in window texture coordinates, flipped
+        // as distort.vert does for the full screen quad
+        vec2 position = params.origin + params.size * vec2(positions[i].x, 1 - positions[i].y);
+        position.y = 1 - position.y;
+
+        vec2 theta = (position - params.lensCenter) * params.scaleIn;
+        float rSq = theta.x * theta.x + theta.y * theta.y;
+        vec2 theta1 = theta * (K.x + K.y * rSq + K.z * rSq * rSq + K.w * rSq * rSq * rSq);
+
+        red.push_back(params.lensCenter + params.scale * theta1 * (C.x + C.y * rSq));
+        green.push_back(params.lensCenter + params.scale * theta1);
+        blue.push_back(params.lensCenter + params.scale * theta1 * (C.z + C.w * rSq));
+    }
+}
+
+DistortionMesh::DistortionMesh(const DistortionParams& params)
+: params(params)
+{
+    vector<vec3> grid = gridPositions();
+    vector<vec2> redCoordinates, greenCoordinates, blueCoordinates;
+    warpGrid(params, grid, redCoordinates, greenCoordinates, blueCoordinates);
+
+    positions = ArrayBuffer<vec3>(grid);
+    red = ArrayBuffer<vec2>(redCoordinates);
+    green = ArrayBuffer<vec2>(greenCoordinates);
+    blue = ArrayBuffer<vec2>(blueCoordinates);
+    indices = ElementArrayBuffer(gridIndices());
+}
+
+DistortionMesh::~DistortionMesh()
+{
+    positions.Delete();
+    red.Delete();
+    green.Delete();
+    blue.Delete();
+    indices.Delete();
+}
+
+void DistortionMesh::Draw(const Program& program) const
+{
+    positions.Use(program, "vertexCoordinates");
+    red.Use(program, "redCoordinates");
+    green.Use(program, "greenCoordinates");
+    blue.Use(program, "blueCoordinates");
+
+    indices.Draw(GL_TRIANGLES);
+
+    positions.Unuse(program, "vertexCoordinates");
+    red.Unuse(program, "redCoordinates");
+    green.Unuse(program, "greenCoordinates");
+    blue.Unuse(program, "blueCoordinates");
+}
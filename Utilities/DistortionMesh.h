@@ -0,0 +1,65 @@
+#pragma once
+
+#include "../gl.h"
+
+#include <glm/glm.hpp>
+
+#include "Buffer.h"
+#include "Program.h"
+
+/* Cells across and down each eye's mesh. The warp is smooth, so
+   interpolating between vertices this close is exact to well under
+   a pixel at the Rift's resolution. */
+#define DISTORTION_MESH_COLUMNS 64
+#define DISTORTION_MESH_ROWS 64
+
+/** What the distortion shader is given for one eye: the lens and its
+    half of the window in window texture coordinates, the scales in
+    and out of the lens' [-1, 1] range, the warp polynomial's K[] and
+    the chromatic aberration terms. */
+struct DistortionParams
+{
+    glm::vec2 lensCenter;
+    glm::vec2 screenCenter;
+    glm::vec2 scale;
+    glm::vec2 scaleIn;
+    glm::vec4 warp;
+    glm::vec4 chromatic;
+
+    /** The eye's part of the window, from 0 to 1 */
+    glm::vec2 origin;
+    glm::vec2 size;
+
+    bool operator==(const DistortionParams& other) const;
+    bool operator!=(const DistortionParams& other) const { return !(*this == other); }
+};
+
+/** A grid over one eye's viewport, with the barrel distortion and
+    chromatic aberration worked out once per vertex instead of once per
+    pixel. Each vertex carries where in the rendered scene the red,
+    green and blue channels are read from; the shaders (distortMesh.vert
+    and .frag) only reproject those and fetch.
+
+    Rebuild it when the parameters change, i.e. when the window is
+    resized or the HMD's configuration changes. */
+class DistortionMesh
+{
+public:
+    DistortionMesh(const DistortionParams& params);
+    ~DistortionMesh();
+
+    /** Returns the parameters the mesh was built for */
+    const DistortionParams& GetParams() const { return params; }
+
+    /** Draws the mesh with the program in use */
+    void Draw(const Program& program) const;
+
+private:
+    DistortionParams params;
+
+    ArrayBuffer<glm::vec3> positions;
+    ArrayBuffer<glm::vec2> red;
+    ArrayBuffer<glm::vec2> green;
+    ArrayBuffer<glm::vec2> blue;
+    ElementArrayBuffer indices;
+};
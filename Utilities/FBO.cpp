@@ -1,15 +1,20 @@
 #include "FBO.h"
+#include "ResourceRegistry.h"
 
 using namespace std;
 
 FBO::FBO(GLfloat width, GLfloat height)
 {
     glGenFramebuffers(1, &id);
+    // Framebuffer names aren't shared between contexts, so the scene
+    // thread's would clash with the window's
+    ResourceRegistry::Add(RESOURCE_FRAMEBUFFER, (uintptr_t) this, 0, "attachments");
 }
 
 FBO::~FBO()
 {
     glDeleteFramebuffers(1, &id);
+    ResourceRegistry::Remove(RESOURCE_FRAMEBUFFER, (uintptr_t) this);
 }
 
 void FBO::Use()
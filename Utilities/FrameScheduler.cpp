@@ -0,0 +1,107 @@
+#include "FrameScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <sys/resource.h>
+
+using namespace std;
+
+/** Returns the CPU time (user and system) used by the process, in milliseconds */
+static double processCPUTime()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0
+         + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+}
+
+FrameScheduler::FrameScheduler(double refreshRate, bool pacing)
+: pacing(pacing), period(1000.0 / refreshRate), created(Clock::now()),
+  startCPU(processCPUTime()), vblank(0), deadline(0),
+  frameStart(0), renderEnd(0), workEstimate(0), lastSwap(-1), missed(0),
+  intervals(FRAME_STATS_HISTORY), lateness(FRAME_STATS_HISTORY)
+{
+}
+
+double FrameScheduler::Now() const
+{
+    chrono::duration<double, milli> elapsed = Clock::now() - created;
+    return elapsed.count();
+}
+
+void FrameScheduler::WaitForFrame()
+{
+    double now = Now();
+    
+    // The first blank after the work could be done
+    double ready = now + workEstimate + FRAME_SAFETY_MARGIN_MS;
+    deadline = vblank + ceil((ready - vblank) / period) * period;
+    
+    if (pacing) {
+        double wake = deadline - workEstimate - FRAME_SAFETY_MARGIN_MS;
+        if (wake - FRAME_SPIN_MS > now) {
+            this_thread::sleep_for(chrono::duration<double, milli>(wake - FRAME_SPIN_MS - now));
+        }
+        while (Now() < wake) {
+            this_thread::yield();
+        }
+    }
+    
+    frameStart = Now();
+}
+
+void FrameScheduler::FrameRendered()
+{
+    // Rises at once on a slow frame, decays slowly after it
+    renderEnd = Now();
+    double work = renderEnd - frameStart;
+    workEstimate = max(work, 0.9 * workEstimate + 0.1 * work);
+    workEstimate = min(workEstimate, period);
+}
+
+void FrameScheduler::FrameSwapped()
+{
+    double now = Now();
+    
+    // Half a period late means the frame was shown a blank later
+    double late = now - deadline;
+    lateness.Add(max(late, 0.0));
+    if (late > period / 2)
+        missed++;
+    
+    // A swap that had to wait returned just after a blank; pull the
+    // phase part of the way towards it, to follow drift without
+    // chasing the odd late wakeup. Swaps that return at once (no
+    // vsync, or a queued flip) say nothing about the blank.
+    if (now - renderEnd > FRAME_SPIN_MS) {
+        double phase = fmod(now - vblank, period);
+        if (phase > period / 2)
+            phase -= period;
+        else if (phase < -period / 2)
+            phase += period;
+        vblank += 0.25 * phase;
+    }
+    
+    if (lastSwap >= 0)
+        intervals.Add(now - lastSwap);
+    lastSwap = now;
+}
+
+double FrameScheduler::GetCPUUsage() const
+{
+    double wall = Now();
+    return (wall > 0) ? (processCPUTime() - startCPU) / wall : 0;
+}
+
+void FrameScheduler::Report(const string& name, ostream& out) const
+{
+    out << name << " (" << (pacing ? "paced" : "unpaced") << ", "
+        << 1000.0 / period << " Hz): " << missed << " of "
+        << intervals.GetCount() << " frames missed their blank, jitter "
+        << intervals.GetStandardDeviation() << " ms, CPU "
+        << 100.0 * GetCPUUsage() << "%" << endl;
+    intervals.Report("  Frame intervals", out);
+    lateness.Report("  Lateness", out);
+}
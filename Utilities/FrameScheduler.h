@@ -0,0 +1,89 @@
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "FrameStats.h"
+
+/* Time kept free between the predicted end of a frame's work and the
+   vertical blank, in milliseconds */
+#define FRAME_SAFETY_MARGIN_MS 2.0
+
+/* Sleep until this long before the wake up time, then yield; sleeps
+   often overshoot by about this much */
+#define FRAME_SPIN_MS 1.0
+
+/** Paces the main loop to the display's refresh.
+
+    Instead of spinning through the idle callback, each frame waits
+    until the latest time it can start and still finish before the
+    next vertical blank, so input is sampled as late as possible and
+    the CPU sleeps in between. The blank is predicted from the times
+    the buffer swaps return, and the work a frame needs is estimated
+    from recent frames.
+
+    Per frame, call WaitForFrame before sampling input, FrameRendered
+    just before swapping buffers and FrameSwapped right after. With
+    pacing off nothing waits, but the same statistics are kept, for
+    comparing the two. */
+class FrameScheduler
+{
+public:
+    /** refreshRate is in Hz */
+    FrameScheduler(double refreshRate, bool pacing = true);
+    
+    /** Sleeps until the next frame should start */
+    void WaitForFrame();
+    
+    /** Marks the end of the frame's work, before the buffer swap */
+    void FrameRendered();
+    
+    /** Marks the buffer swap's return */
+    void FrameSwapped();
+    
+    bool IsPacing() const { return pacing; }
+    
+    /** Returns the refresh period, in milliseconds */
+    double GetPeriod() const { return period; }
+    
+    /** Returns the milliseconds left until the blank the current
+        frame is aiming for */
+    double GetTimeToDeadline() const { return deadline - Now(); }
+    
+    /** Returns the number of frames that missed their blank */
+    long GetMissedFrames() const { return missed; }
+    
+    /** Returns the fraction of wall time spent on the CPU (user and
+        system) since the scheduler was created */
+    double GetCPUUsage() const;
+    
+    /** Prints frame intervals, jitter, missed blanks and CPU usage */
+    void Report(const std::string& name, std::ostream& out = std::cout) const;
+    
+private:
+    typedef std::chrono::steady_clock Clock;
+    
+    /** Milliseconds from the scheduler's creation */
+    double Now() const;
+    
+    bool pacing;
+    double period;
+    
+    Clock::time_point created;
+    double startCPU;
+    
+    /** A time the blank was seen at; blanks are a whole number of
+        periods from it */
+    double vblank;
+    double deadline;
+    
+    double frameStart;
+    double renderEnd;
+    double workEstimate;
+    double lastSwap;
+    
+    long missed;
+    FrameStats intervals;
+    FrameStats lateness;
+};
@@ -0,0 +1,89 @@
+#include "FrameStats.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+FrameStats::FrameStats(size_t capacity)
+: capacity(capacity)
+{
+    Clear();
+}
+
+void FrameStats::Add(double milliseconds)
+{
+    count++;
+    if (count == 1) {
+        minimum = maximum = milliseconds;
+    }
+    else {
+        minimum = min(minimum, milliseconds);
+        maximum = max(maximum, milliseconds);
+    }
+    
+    // Welford's update, which doesn't need the samples again
+    double delta = milliseconds - mean;
+    mean += delta / count;
+    squares += delta * (milliseconds - mean);
+    
+    if (!capacity || samples.size() < capacity) {
+        samples.push_back(milliseconds);
+        return;
+    }
+    
+    // Keep the new sample with the chance any earlier one was kept
+    size_t slot = uniform_int_distribution<size_t>(0, count - 1)(random);
+    if (slot < capacity)
+        samples[slot] = milliseconds;
+}
+
+void FrameStats::Clear()
+{
+    samples.clear();
+    count = 0;
+    minimum = maximum = mean = squares = 0;
+    random.seed();
+}
+
+double FrameStats::GetStandardDeviation() const
+{
+    return (count < 2) ? 0 : sqrt(squares / (count - 1));
+}
+
+double FrameStats::GetPercentile(double fraction) const
+{
+    if (samples.empty())
+        return 0;
+    
+    // Nearest rank
+    vector<double> sorted(samples);
+    size_t rank = (size_t) ceil(fraction * sorted.size());
+    rank = (rank > 0) ? rank - 1 : 0;
+    rank = min(rank, sorted.size() - 1);
+    nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    return sorted[rank];
+}
+
+void FrameStats::Report(const string& name, ostream& out) const
+{
+    out << name << " (" << count << " frames, ms): "
+        << "min " << GetMin()
+        << ", mean " << GetMean()
+        << ", p50 " << GetPercentile(0.50)
+        << ", p95 " << GetPercentile(0.95)
+        << ", p99 " << GetPercentile(0.99)
+        << ", max " << GetMax() << endl;
+}
+
+void FrameStats::WriteJSON(ostream& out) const
+{
+    out << "{ \"count\": " << count
+        << ", \"min\": " << GetMin()
+        << ", \"mean\": " << GetMean()
+        << ", \"stddev\": " << GetStandardDeviation()
+        << ", \"p50\": " << GetPercentile(0.50)
+        << ", \"p95\": " << GetPercentile(0.95)
+        << ", \"p99\": " << GetPercentile(0.99)
+        << ", \"max\": " << GetMax() << " }";
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+/* Samples kept by the stats that run for a whole interactive session,
+   which may last hours. Benchmarks are far shorter, so theirs stay
+   exact. */
+#define FRAME_STATS_HISTORY 16384
+
+/** Collects frame times (in milliseconds) and summarizes them.
+
+    With a capacity, once that many samples have been added only a
+    uniform random sample of all of them is kept (a reservoir), and the
+    percentiles are estimated from it; the count, min, max, mean and
+    deviation stay exact. Without one, every sample is kept. */
+class FrameStats
+{
+public:
+    explicit FrameStats(size_t capacity = 0);
+    
+    void Add(double milliseconds);
+    void Clear();
+    size_t GetCount() const { return count; }
+    
+    /** Returns the samples kept: all of them, unless capped */
+    size_t GetSampleCount() const { return samples.size(); }
+    double GetSample(size_t i) const { return samples[i]; }
+    
+    double GetMin() const { return minimum; }
+    double GetMax() const { return maximum; }
+    double GetMean() const { return mean; }
+    double GetStandardDeviation() const;
+    
+    /** Returns the frame time below which the given fraction
+        (0 to 1) of frames fall, e.g. 0.99 for p99 */
+    double GetPercentile(double fraction) const;
+    
+    /** Prints count, min, mean, p50, p95, p99 and max */
+    void Report(const std::string& name, std::ostream& out = std::cout) const;
+    
+    /** Writes the same summary as a JSON object */
+    void WriteJSON(std::ostream& out) const;
+    
+private:
+    std::vector<double> samples;
+    size_t capacity;
+    
+    /** Running totals over every sample, kept or not; squares is the
+        sum of squared differences from the mean */
+    size_t count;
+    double minimum, maximum, mean, squares;
+    
+    /** Picks the samples a full reservoir keeps; seeded the same each
+        time, so reports repeat */
+    std::minstd_rand random;
+};
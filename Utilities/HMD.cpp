@@ -0,0 +1,44 @@
+#include "HMD.h"
+
+#include <iostream>
+
+#include "LibOVRHMD.h"
+#include "SyntheticHMD.h"
+#include "ReplayHMD.h"
+
+using namespace std;
+
+HMD *HMD::Create(const string& spec)
+{
+    size_t colon = spec.find(':');
+    string backend = spec.substr(0, colon);
+    string argument = (colon == string::npos) ? "" : spec.substr(colon + 1);
+    
+    if (backend == "ovr") {
+#if HMD_LIBOVR
+        return new LibOVRHMD();
+#else
+        cerr << "Warning: built without the LibOVR backend" << endl;
+        return NULL;
+#endif
+    }
+    if (backend == "synthetic") {
+        SyntheticHMD *hmd = new SyntheticHMD();
+        if (!argument.empty() && !hmd->Load(argument)) {
+            delete hmd;
+            return NULL;
+        }
+        return hmd;
+    }
+    if (backend == "replay") {
+        ReplayHMD *hmd = new ReplayHMD(argument);
+        if (!hmd->IsLoaded()) {
+            delete hmd;
+            return NULL;
+        }
+        return hmd;
+    }
+    
+    cerr << "Warning: unknown HMD backend " << backend << endl;
+    return NULL;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <glm/gtc/quaternion.hpp>
+#include "../LibOVR/Include/OVR.h"
+
+/* Whether the LibOVR device backend is built. Its device code only
+   exists for Mac OS X; elsewhere only the synthetic and replay
+   backends are available. */
+#ifndef HMD_LIBOVR
+#ifdef __APPLE__
+#define HMD_LIBOVR 1
+#else
+#define HMD_LIBOVR 0
+#endif
+#endif
+
+/** A head mounted display: the optics the stereo and distortion
+    setup is computed from, and the sensor tracking the head.
+
+    Orientations are in the application's frame (z up, y forward).
+    Backends: "ovr" (LibOVR devices), "synthetic" (a scripted head on
+    a configurable display) and "replay" (a recorded sensor log). */
+class HMD
+{
+public:
+    virtual ~HMD() {}
+    
+    /** Returns the backend's name, for logging */
+    virtual const char *GetName() const = 0;
+    
+    /** Fills in the display's description. Returns false if there is
+        no display, in which case rendering uses a plain window. */
+    virtual bool GetInfo(OVR::HMDInfo& info) = 0;
+    
+    /** Returns whether GetOrientation follows a head */
+    virtual bool HasSensor() const = 0;
+    
+    /** Returns the latest head orientation */
+    virtual glm::quat GetOrientation() = 0;
+    
+    /** Returns how old (in milliseconds) the sample GetOrientation
+        last returned was when it was read, if the backend knows */
+    virtual double GetSampleAge() const { return 0; }
+    
+    /** Creates a backend from a specification: "ovr", "synthetic",
+        "synthetic:<config file>" or "replay:<log file>". Returns
+        NULL (with a warning) if it can't be created. */
+    static HMD *Create(const std::string& spec);
+};
@@ -0,0 +1,136 @@
+#include "HeadlessContext.h"
+
+#ifndef __APPLE__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <iostream>
+
+using namespace std;
+
+#ifdef __APPLE__
+
+struct HeadlessContext::Handles
+{
+};
+
+HeadlessContext::HeadlessContext(int width, int height)
+: handles(new Handles())
+{
+    cerr << "Warning: headless contexts need EGL, which OS X doesn't have" << endl;
+}
+
+HeadlessContext::~HeadlessContext()
+{
+    delete handles;
+}
+
+bool HeadlessContext::IsValid() const
+{
+    return false;
+}
+
+bool HeadlessContext::MakeCurrent()
+{
+    return false;
+}
+
+#else
+
+struct HeadlessContext::Handles
+{
+    EGLDisplay display;
+    EGLSurface surface;
+    EGLContext context;
+};
+
+/** Returns Mesa's surfaceless display, which needs no X server or
+    render node, or else the default display */
+static EGLDisplay openDisplay()
+{
+    EGLDisplay display = EGL_NO_DISPLAY;
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay)
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+#endif
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    return display;
+}
+
+HeadlessContext::HeadlessContext(int width, int height)
+: handles(new Handles())
+{
+    handles->display = openDisplay();
+    handles->surface = EGL_NO_SURFACE;
+    handles->context = EGL_NO_CONTEXT;
+
+    EGLint major, minor;
+    if (handles->display == EGL_NO_DISPLAY || !eglInitialize(handles->display, &major, &minor)) {
+        cerr << "Warning: unable to open an EGL display" << endl;
+        return;
+    }
+
+    // Same buffers GLUT is asked for: RGBA with a depth buffer
+    EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint count = 0;
+    if (!eglChooseConfig(handles->display, configAttributes, &config, 1, &count) || count == 0) {
+        cerr << "Warning: no EGL configuration can render OpenGL offscreen" << endl;
+        return;
+    }
+
+    EGLint surfaceAttributes[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+    handles->surface = eglCreatePbufferSurface(handles->display, config, surfaceAttributes);
+    if (handles->surface == EGL_NO_SURFACE) {
+        cerr << "Warning: unable to create a " << width << "x" << height << " pbuffer" << endl;
+        return;
+    }
+
+    // A compatibility context, as the renderer still uses the fixed
+    // function matrix stacks
+    eglBindAPI(EGL_OPENGL_API);
+    handles->context = eglCreateContext(handles->display, config, EGL_NO_CONTEXT, NULL);
+    if (handles->context == EGL_NO_CONTEXT) {
+        cerr << "Warning: unable to create an EGL context" << endl;
+        return;
+    }
+    if (!MakeCurrent()) {
+        cerr << "Warning: unable to make the EGL context current" << endl;
+    }
+}
+
+HeadlessContext::~HeadlessContext()
+{
+    if (handles->display != EGL_NO_DISPLAY) {
+        eglMakeCurrent(handles->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (handles->context != EGL_NO_CONTEXT)
+            eglDestroyContext(handles->display, handles->context);
+        if (handles->surface != EGL_NO_SURFACE)
+            eglDestroySurface(handles->display, handles->surface);
+        eglTerminate(handles->display);
+    }
+    delete handles;
+}
+
+bool HeadlessContext::IsValid() const
+{
+    return handles->context != EGL_NO_CONTEXT;
+}
+
+bool HeadlessContext::MakeCurrent()
+{
+    return handles->context != EGL_NO_CONTEXT
+        && eglMakeCurrent(handles->display, handles->surface, handles->surface, handles->context);
+}
+
+#endif
@@ -0,0 +1,29 @@
+#pragma once
+
+/** An OpenGL context with no window or display, for rendering on
+    machines that have neither (build servers, with Mesa's llvmpipe
+    standing in for the GPU).
+
+    It is made with EGL on Mesa's surfaceless platform, falling back
+    to the default EGL display, and draws into a pbuffer of the given
+    size, which stands in for the window's framebuffer. EGL isn't
+    available on OS X, where no context is made.
+
+    As with SharedContext, the window system's types stay in the .cpp. */
+class HeadlessContext
+{
+public:
+    /** Creates the context and makes it current on the calling thread */
+    HeadlessContext(int width, int height);
+    ~HeadlessContext();
+
+    /** Returns whether the context was created */
+    bool IsValid() const;
+
+    /** Makes the context current on the calling thread */
+    bool MakeCurrent();
+
+private:
+    struct Handles;
+    Handles *handles;
+};
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "bitmap_image.hpp"
+
+/** Conversion between stored samples and heights in [0, 1].
+    Heights can be kept as floats, or quantized to 16 bits
+    to halve the memory (and cache) footprint. */
+template <typename T>
+struct HeightSample;
+
+template <>
+struct HeightSample<float>
+{
+    static float Encode(float height) { return height; }
+    static float Scale() { return 1.0f; }
+};
+
+template <>
+struct HeightSample<uint16_t>
+{
+    static uint16_t Encode(float height) {
+        if (height <= 0.0f) return 0;
+        if (height >= 1.0f) return 65535;
+        return (uint16_t) (height * 65535.0f + 0.5f);
+    }
+    static float Scale() { return 1.0f / 65535.0f; }
+};
+
+/** Single-channel height field with precomputed heights.
+
+    Heights are averaged from the source bitmap's channels once at
+    construction, and stored with a wrapped border (one texel on the
+    top/left, two on the bottom/right). Queries wrap their coordinates
+    once with a multiply, and the border takes care of the neighbouring
+    texels, so sampling never needs a per-texel modulo.
+
+    Coordinates are in texels, like bitmap_image::get_interpolated_height. */
+template <typename T>
+class HeightField
+{
+public:
+    /** Builds the height field from the average of the bitmap's
+        r, g and b channels (same as bitmap_image::get_height) */
+    HeightField(bitmap_image *image) {
+        Allocate(image->width(), image->height());
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                unsigned char r, g, b;
+                image->get_pixel(x, y, r, g, b);
+                Set(x, y, (r + g + b) / 765.0f);
+            }
+        }
+        FillBorder();
+    }
+
+    /** Builds the height field from a row-major array of
+        width * height heights in [0, 1] */
+    HeightField(int width, int height, const float *heights) {
+        Allocate(width, height);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                Set(x, y, heights[y * width + x]);
+            }
+        }
+        FillBorder();
+    }
+
+    /** Get dimensions */
+    int GetWidth() const { return width; }
+    int GetHeight() const { return height; }
+
+    /** Returns the height at texel (x, y). x and y may be anywhere in
+        [-1, width + 1] and [-1, height + 1] respectively. */
+    float Get(int x, int y) const {
+        return samples[Index(x, y)] * HeightSample<T>::Scale();
+    }
+
+    /** Returns a pointer to texel (0, y). Texels -1 to width + 1
+        of the row are valid. */
+    const T *GetRow(int y) const { return &samples[Index(0, y)]; }
+
+    /** Returns the bilinearly interpolated height at (x, y). Coordinates
+        outside the field wrap around. */
+    float Sample(float x, float y) const {
+        x -= floorf(x * invWidth) * width;
+        y -= floorf(y * invHeight) * height;
+
+        int x0 = (int) x;
+        int y0 = (int) y;
+        float fx = x - x0;
+        float fy = y - y0;
+
+        const T *top = &samples[Index(x0, y0)];
+        const T *bottom = top + stride;
+        float z0 = top[0] + (top[1] - (float) top[0]) * fx;
+        float z1 = bottom[0] + (bottom[1] - (float) bottom[0]) * fx;
+        return (z0 + (z1 - z0) * fy) * HeightSample<T>::Scale();
+    }
+
+    /** Batched sampling: out[i] = Sample(x[i], y[i]) */
+    void Sample(const float *x, const float *y, float *out, size_t count) const {
+        for (size_t i = 0; i < count; i++) {
+            out[i] = Sample(x[i], y[i]);
+        }
+    }
+
+    /** Batched sampling, four queries at a time with SSE2. Falls back
+        to the scalar batch where SSE2 is not available. */
+    void SampleSIMD(const float *x, const float *y, float *out, size_t count) const {
+#ifdef __SSE2__
+        const __m128 w = _mm_set1_ps((float) width);
+        const __m128 h = _mm_set1_ps((float) height);
+        const __m128 invW = _mm_set1_ps(invWidth);
+        const __m128 invH = _mm_set1_ps(invHeight);
+        const __m128 scale = _mm_set1_ps(HeightSample<T>::Scale());
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            // Wrap into [0, width] x [0, height]
+            __m128 vx = _mm_loadu_ps(x + i);
+            __m128 vy = _mm_loadu_ps(y + i);
+            vx = _mm_sub_ps(vx, _mm_mul_ps(Floor(_mm_mul_ps(vx, invW)), w));
+            vy = _mm_sub_ps(vy, _mm_mul_ps(Floor(_mm_mul_ps(vy, invH)), h));
+
+            // Coordinates are positive now, so truncation is floor
+            __m128i ix = _mm_cvttps_epi32(vx);
+            __m128i iy = _mm_cvttps_epi32(vy);
+            __m128 fx = _mm_sub_ps(vx, _mm_cvtepi32_ps(ix));
+            __m128 fy = _mm_sub_ps(vy, _mm_cvtepi32_ps(iy));
+
+            // Gather the four corners of each query
+            int32_t cx[4], cy[4];
+            _mm_storeu_si128((__m128i *) cx, ix);
+            _mm_storeu_si128((__m128i *) cy, iy);
+            float z00[4], z10[4], z01[4], z11[4];
+            for (int lane = 0; lane < 4; lane++) {
+                const T *top = &samples[Index(cx[lane], cy[lane])];
+                z00[lane] = top[0];
+                z10[lane] = top[1];
+                z01[lane] = top[stride];
+                z11[lane] = top[stride + 1];
+            }
+
+            // Lerp twice in x, then in y
+            __m128 a = _mm_loadu_ps(z00);
+            __m128 b = _mm_loadu_ps(z01);
+            __m128 z0 = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(z10), a), fx));
+            __m128 z1 = _mm_add_ps(b, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(z11), b), fx));
+            __m128 z = _mm_add_ps(z0, _mm_mul_ps(_mm_sub_ps(z1, z0), fy));
+            _mm_storeu_ps(out + i, _mm_mul_ps(z, scale));
+        }
+
+        // Remainder
+        Sample(x + i, y + i, out + i, count - i);
+#else
+        Sample(x, y, out, count);
+#endif
+    }
+
+    /** Returns the number of bytes used by the samples */
+    size_t GetMemoryUsage() const { return samples.size() * sizeof(T); }
+
+private:
+    int width, height, stride;
+    float invWidth, invHeight;
+    std::vector<T> samples;
+
+    void Allocate(int w, int h) {
+        width = w;
+        height = h;
+        stride = width + 3;
+        invWidth = 1.0f / width;
+        invHeight = 1.0f / height;
+        samples.resize((size_t) stride * (height + 3));
+    }
+
+    size_t Index(int x, int y) const {
+        return (size_t) (y + 1) * stride + (x + 1);
+    }
+
+    void Set(int x, int y, float value) {
+        samples[Index(x, y)] = HeightSample<T>::Encode(value);
+    }
+
+    /** Copies wrapped texels into the border */
+    void FillBorder() {
+        for (int y = 0; y < height; y++) {
+            samples[Index(-1, y)] = samples[Index(width - 1, y)];
+            samples[Index(width, y)] = samples[Index(0, y)];
+            samples[Index(width + 1, y)] = samples[Index(1 % width, y)];
+        }
+        for (int x = -1; x <= width + 1; x++) {
+            samples[Index(x, -1)] = samples[Index(x, height - 1)];
+            samples[Index(x, height)] = samples[Index(x, 0)];
+            samples[Index(x, height + 1)] = samples[Index(x, 1 % height)];
+        }
+    }
+
+#ifdef __SSE2__
+    /** SSE2 has no floor instruction: truncate, then fix up negatives */
+    static __m128 Floor(__m128 v) {
+        __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+        return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, v), _mm_set1_ps(1.0f)));
+    }
+#endif
+};
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "HeightField.hpp"
+#include "ThreadPool.h"
+
+/** A ray against the terrain. Coordinates are in height field units:
+    x and y in texels, z in heights (as returned by HeightField::Sample). */
+struct TerrainRay
+{
+    TerrainRay() : tMax(std::numeric_limits<float>::max()) {}
+    TerrainRay(glm::vec3 origin, glm::vec3 direction, float tMax)
+    : origin(origin), direction(direction), tMax(tMax) {}
+
+    glm::vec3 origin;
+    glm::vec3 direction;
+    float tMax;
+};
+
+/** Result of a terrain ray cast */
+struct TerrainHit
+{
+    TerrainHit() : hit(false), t(0) {}
+
+    bool hit;
+    float t;            // Ray parameter of the hit
+    glm::vec3 position; // origin + t * direction
+};
+
+/** Min/max height pyramid (a max-mip quadtree) over a HeightField.
+
+    Level 0 holds the height range of each texel cell, i.e. the bilinear
+    patch between texels (x, y) and (x + 1, y + 1). Each level above
+    halves the resolution and holds the range of its (up to) four
+    children. Ray casts walk the quadtree front to back and skip any
+    node the ray passes over, so empty space costs one box test per
+    node instead of one height sample per texel.
+
+    Rays are clipped to the base tile, [0, width] x [0, height]; the
+    wrapped copies of the terrain are not traversed. */
+template <typename T>
+class HeightPyramid
+{
+public:
+    HeightPyramid(const HeightField<T>& field)
+    : field(field), width(field.GetWidth()), height(field.GetHeight())
+    {
+        // Level 0: range of each cell's four corners
+        int w = width, h = height;
+        levels.push_back(Level(w, h));
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                float z00 = field.Get(x, y), z10 = field.Get(x + 1, y);
+                float z01 = field.Get(x, y + 1), z11 = field.Get(x + 1, y + 1);
+                Range& r = levels[0].At(x, y);
+                r.min = std::min(std::min(z00, z10), std::min(z01, z11));
+                r.max = std::max(std::max(z00, z10), std::max(z01, z11));
+            }
+        }
+
+        // Coarser levels
+        while (w > 1 || h > 1) {
+            const Level& child = levels.back();
+            Level parent((w + 1) / 2, (h + 1) / 2);
+            for (int y = 0; y < parent.height; y++) {
+                for (int x = 0; x < parent.width; x++) {
+                    Range r = child.At(2 * x, 2 * y);
+                    int cx = std::min(2 * x + 1, child.width - 1);
+                    int cy = std::min(2 * y + 1, child.height - 1);
+                    r.Merge(child.At(cx, 2 * y));
+                    r.Merge(child.At(2 * x, cy));
+                    r.Merge(child.At(cx, cy));
+                    parent.At(x, y) = r;
+                }
+            }
+            w = parent.width;
+            h = parent.height;
+            levels.push_back(parent);
+        }
+    }
+
+    /** Returns the number of levels, including the cell level */
+    int GetLevelCount() const { return (int) levels.size(); }
+
+    /** Returns the lowest and highest height of the terrain */
+    float GetMinHeight() const { return levels.back().At(0, 0).min; }
+    float GetMaxHeight() const { return levels.back().At(0, 0).max; }
+
+    /** Finds the first point where the ray meets the terrain surface.
+        @return true on a hit within [0, ray.tMax] */
+    bool Intersect(const TerrainRay& ray, TerrainHit& hit) const
+    {
+        hit = TerrainHit();
+
+        glm::vec3 inv(1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z);
+
+        // Front-to-back order of a node's children
+        int firstX = (ray.direction.x >= 0) ? 0 : 1;
+        int firstY = (ray.direction.y >= 0) ? 0 : 1;
+
+        struct Node { int level, x, y; };
+        Node stack[4 * 32];
+        int top = 0;
+        stack[top++] = { (int) levels.size() - 1, 0, 0 };
+
+        while (top > 0) {
+            Node node = stack[--top];
+            const Level& level = levels[node.level];
+            const Range& range = level.At(node.x, node.y);
+
+            // Node bounds in texels
+            float x0 = (float) (node.x << node.level);
+            float y0 = (float) (node.y << node.level);
+            float x1 = std::min((float) ((node.x + 1) << node.level), (float) width);
+            float y1 = std::min((float) ((node.y + 1) << node.level), (float) height);
+
+            float tEnter = 0, tExit = ray.tMax;
+            if (!Clip(ray.origin.x, ray.direction.x, inv.x, x0, x1, tEnter, tExit) ||
+                !Clip(ray.origin.y, ray.direction.y, inv.y, y0, y1, tEnter, tExit) ||
+                !Clip(ray.origin.z, ray.direction.z, inv.z, range.min, range.max, tEnter, tExit))
+                continue;
+
+            if (node.level == 0) {
+                float t;
+                if (IntersectCell(ray, node.x, node.y, tEnter, tExit, t)) {
+                    hit.hit = true;
+                    hit.t = t;
+                    hit.position = ray.origin + t * ray.direction;
+                    return true;
+                }
+                continue;
+            }
+
+            // Push children far to near, so the nearest is popped first
+            const Level& children = levels[node.level - 1];
+            for (int i = 3; i >= 0; i--) {
+                int cx = 2 * node.x + ((i & 1) ^ firstX);
+                int cy = 2 * node.y + (((i >> 1) & 1) ^ firstY);
+                if (cx < children.width && cy < children.height) {
+                    Node child = { node.level - 1, cx, cy };
+                    stack[top++] = child;
+                }
+            }
+        }
+        return false;
+    }
+
+    /** Casts a batch of rays. With a thread pool, the batch is split
+        across its workers. */
+    void Intersect(const TerrainRay *rays, TerrainHit *hits, size_t count,
+                   ThreadPool *pool = NULL) const
+    {
+        if (!pool) {
+            for (size_t i = 0; i < count; i++)
+                Intersect(rays[i], hits[i]);
+            return;
+        }
+        pool->ParallelFor(count, 256, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                Intersect(rays[i], hits[i]);
+        });
+    }
+
+private:
+    struct Range
+    {
+        float min, max;
+
+        void Merge(const Range& other) {
+            min = std::min(min, other.min);
+            max = std::max(max, other.max);
+        }
+    };
+
+    struct Level
+    {
+        Level(int width, int height)
+        : width(width), height(height), ranges((size_t) width * height) {}
+
+        Range& At(int x, int y) { return ranges[(size_t) y * width + x]; }
+        const Range& At(int x, int y) const { return ranges[(size_t) y * width + x]; }
+
+        int width, height;
+        std::vector<Range> ranges;
+    };
+
+    const HeightField<T>& field;
+    int width, height;
+    std::vector<Level> levels;
+
+    /** Slab test along one axis; narrows [tEnter, tExit] */
+    static bool Clip(float origin, float direction, float inv,
+                     float lo, float hi, float& tEnter, float& tExit)
+    {
+        if (direction == 0)
+            return origin >= lo && origin <= hi;
+        float ta = (lo - origin) * inv;
+        float tb = (hi - origin) * inv;
+        if (ta > tb)
+            std::swap(ta, tb);
+        tEnter = std::max(tEnter, ta);
+        tExit = std::min(tExit, tb);
+        return tEnter <= tExit;
+    }
+
+    /** Exact intersection with the bilinear patch of cell (x, y),
+        within [tEnter, tExit]. Along the ray, height minus ray z
+        is a quadratic in t. */
+    bool IntersectCell(const TerrainRay& ray, int x, int y,
+                       float tEnter, float tExit, float& t) const
+    {
+        float z00 = field.Get(x, y), z10 = field.Get(x + 1, y);
+        float z01 = field.Get(x, y + 1), z11 = field.Get(x + 1, y + 1);
+
+        // h(u, v) = a + b u + c v + e u v, with (u, v) local to the cell
+        float a = z00;
+        float b = z10 - z00;
+        float c = z01 - z00;
+        float e = z00 - z10 - z01 + z11;
+
+        float u0 = ray.origin.x - x, v0 = ray.origin.y - y;
+        float du = ray.direction.x, dv = ray.direction.y;
+
+        float A = e * du * dv;
+        float B = b * du + c * dv + e * (u0 * dv + v0 * du) - ray.direction.z;
+        float C = a + b * u0 + c * v0 + e * u0 * v0 - ray.origin.z;
+
+        // Already at or below the surface where the ray enters the cell
+        if (C + (B + A * tEnter) * tEnter >= 0) {
+            t = tEnter;
+            return true;
+        }
+
+        float roots[2];
+        int count = 0;
+        if (fabsf(A) < 1e-12f) {
+            if (B != 0)
+                roots[count++] = -C / B;
+        }
+        else {
+            float discriminant = B * B - 4 * A * C;
+            if (discriminant < 0)
+                return false;
+            // Numerically stable form of the quadratic formula
+            float q = -0.5f * (B + copysignf(sqrtf(discriminant), B));
+            roots[count++] = q / A;
+            if (q != 0)
+                roots[count++] = C / q;
+            if (count == 2 && roots[1] < roots[0])
+                std::swap(roots[0], roots[1]);
+        }
+
+        for (int i = 0; i < count; i++) {
+            if (roots[i] >= tEnter && roots[i] <= tExit) {
+                t = roots[i];
+                return true;
+            }
+        }
+        return false;
+    }
+};
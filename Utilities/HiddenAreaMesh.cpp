@@ -0,0 +1,113 @@
+#include "HiddenAreaMesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace std;
+using namespace glm;
+
+/** How far along a ray from origin, in multiples of direction, it
+    leaves the box from low to high */
+static float exitDistance(vec2 origin, vec2 direction, vec2 low, vec2 high)
+{
+    float distance = INFINITY;
+    if (direction.x > 0)
+        distance = min(distance, (high.x - origin.x) / direction.x);
+    else if (direction.x < 0)
+        distance = min(distance, (low.x - origin.x) / direction.x);
+    if (direction.y > 0)
+        distance = min(distance, (high.y - origin.y) / direction.y);
+    else if (direction.y < 0)
+        distance = min(distance, (low.y - origin.y) / direction.y);
+    return distance;
+}
+
+/** The area of a triangle in the xy plane */
+static float triangleArea(const vec3& a, const vec3& b, const vec3& c)
+{
+    return 0.5f * fabs((b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y));
+}
+
+/** The warp's scaling at a squared radius, for whichever channel is
+    read furthest out there */
+static float outermostWarp(const DistortionParams& params, float rSq)
+{
+    const vec4& K = params.warp;
+    const vec4& C = params.chromatic;
+    float warp = K.x + K.y * rSq + K.z * rSq * rSq + K.w * rSq * rSq * rSq;
+    return warp * max(max(C.x + C.y * rSq, 1.0f), C.z + C.w * rSq);
+}
+
+HiddenAreaMesh::HiddenAreaMesh(const DistortionParams& params)
+: params(params), hiddenFraction(0)
+{
+    // The eye's part of the window and of the scene, in the window
+    // texture coordinates the distortion works in (see DistortionMesh)
+    vec2 low(params.origin.x, 1 - params.origin.y - params.size.y);
+    vec2 high = low + params.size;
+    
+    // Rays are spaced by angle in the lens' [-1, 1] range, plus one
+    // through each corner so the outline follows the eye's edges
+    vector<float> angles;
+    for (int i = 0; i < HIDDEN_AREA_RAYS; i++)
+        angles.push_back(i * 2 * (float) M_PI / HIDDEN_AREA_RAYS);
+    vec2 corners[4] = { low, vec2(high.x, low.y), high, vec2(low.x, high.y) };
+    for (int i = 0; i < 4; i++) {
+        vec2 direction = (corners[i] - params.lensCenter) / params.scale;
+        float angle = atan2(direction.y, direction.x);
+        angles.push_back(angle < 0 ? angle + 2 * (float) M_PI : angle);
+    }
+    sort(angles.begin(), angles.end());
+    
+    // Along each ray, the window's pixels inside the viewport read the
+    // scene out to where the viewport's edge is warped to; from there
+    // (with a margin) to the eye's edge is never read
+    vector<vec3> vertices;
+    for (size_t i = 0; i < angles.size(); i++) {
+        vec2 theta(cos(angles[i]), sin(angles[i]));
+        vec2 direction = params.scale * theta;
+        
+        float viewportEdge = exitDistance(params.lensCenter, theta / params.scaleIn, low, high);
+        float shown = viewportEdge * outermostWarp(params, viewportEdge * viewportEdge);
+        float eyeEdge = exitDistance(params.lensCenter, direction, low, high);
+        float hidden = min(shown * (1 + HIDDEN_AREA_MARGIN), eyeEdge);
+        
+        vec2 inner = (params.lensCenter + direction * hidden - low) / params.size;
+        vec2 outer = (params.lensCenter + direction * eyeEdge - low) / params.size;
+        vertices.push_back(vec3(inner, 0));
+        vertices.push_back(vec3(outer, 0));
+    }
+    
+    // A strip of two triangles between each ray and the next, round
+    // the lens center
+    vector<size_t> triangles;
+    for (size_t i = 0; i < angles.size(); i++) {
+        size_t inner = 2 * i, next = 2 * ((i + 1) % angles.size());
+        triangles.push_back(inner);
+        triangles.push_back(inner + 1);
+        triangles.push_back(next + 1);
+        triangles.push_back(inner);
+        triangles.push_back(next + 1);
+        triangles.push_back(next);
+
+        hiddenFraction += triangleArea(vertices[inner], vertices[inner + 1], vertices[next + 1])
+                        + triangleArea(vertices[inner], vertices[next + 1], vertices[next]);
+    }
+    
+    positions = ArrayBuffer<vec3>(vertices);
+    indices = ElementArrayBuffer(triangles);
+}
+
+HiddenAreaMesh::~HiddenAreaMesh()
+{
+    positions.Delete();
+    indices.Delete();
+}
+
+void HiddenAreaMesh::Draw(const Program& program) const
+{
+    positions.Use(program, "vertexCoordinates");
+    indices.Draw(GL_TRIANGLES);
+    positions.Unuse(program, "vertexCoordinates");
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "../gl.h"
+
+#include <glm/glm.hpp>
+
+#include "Buffer.h"
+#include "DistortionMesh.h"
+#include "Program.h"
+
+/* Rays from the lens center the mesh is built along, besides the ones
+   through the eye's corners */
+#define HIDDEN_AREA_RAYS 256
+
+/* Room left outside what the lens shows, as a fraction of the
+   distance from the lens center, for late latching's reprojection to
+   move the view into */
+#define HIDDEN_AREA_MARGIN 0.02f
+
+/** The part of an eye buffer the lens never shows: pixels outside the
+    image of the eye's viewport under the barrel distortion, which no
+    channel of the distortion pass ever reads. Worked out from the same
+    parameters as the distortion, along rays from the lens center.
+
+    Drawn at the near plane into the depth buffer before the scene (see
+    hiddenArea.vert and .frag), it makes the depth test reject every
+    fragment there before it is shaded. Vertices are in the eye's
+    viewport, from (0, 0) to (1, 1). Rebuild it when the parameters
+    change. */
+class HiddenAreaMesh
+{
+public:
+    HiddenAreaMesh(const DistortionParams& params);
+    ~HiddenAreaMesh();
+
+    /** Returns the parameters the mesh was built for */
+    const DistortionParams& GetParams() const { return params; }
+
+    /** Returns the share of the eye buffer the mesh covers */
+    float GetHiddenFraction() const { return hiddenFraction; }
+
+    /** Draws the mesh with the program in use */
+    void Draw(const Program& program) const;
+
+private:
+    DistortionParams params;
+    float hiddenFraction;
+
+    ArrayBuffer<glm::vec3> positions;
+    ElementArrayBuffer indices;
+};
@@ -0,0 +1,160 @@
+#include "LatencyTracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+using namespace std;
+
+/** The stages reported, as pairs of stamps. The sensor is measured
+    to the submit rather than to the simulation, as late latching reads
+    it again after the simulation has run. */
+static const struct
+{
+    LatencyStamp from, to;
+    const char *name;
+} stageTable[LATENCY_STAGES] = {
+    { LATENCY_SENSOR,     LATENCY_SUBMIT, "Sensor to submit" },
+    { LATENCY_SIMULATION, LATENCY_SUBMIT, "Simulation to submit" },
+    { LATENCY_SUBMIT,     LATENCY_GPU,    "Submit to GPU done" },
+    { LATENCY_GPU,        LATENCY_SWAP,   "GPU done to swap" },
+    { LATENCY_SENSOR,     LATENCY_SWAP,   "Motion to photon (sensor to swap)" },
+};
+
+/* Stamp not set this frame */
+static const double UNMARKED = -1.0e30;
+
+LatencyTracker::LatencyTracker()
+: created(chrono::steady_clock::now()), gpuOffset(0), frame(0), collected(0)
+{
+    fill(current, current + LATENCY_STAMPS, UNMARKED);
+    fill(queries, queries + LATENCY_QUERY_FRAMES, 0);
+    for (int i = 0; i < LATENCY_STAGES; i++) {
+        stages[i] = FrameStats(FRAME_STATS_HISTORY);
+    }
+#ifndef __APPLE__
+    if (GLEW_ARB_timer_query) {
+        glGenQueries(LATENCY_QUERY_FRAMES, queries);
+    }
+#endif
+}
+
+LatencyTracker::~LatencyTracker()
+{
+    if (HasGPUTimes())
+        glDeleteQueries(LATENCY_QUERY_FRAMES, queries);
+}
+
+double LatencyTracker::Now() const
+{
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - created;
+    return elapsed.count();
+}
+
+void LatencyTracker::Mark(LatencyStamp stamp, double ago)
+{
+    current[stamp] = Now() - ago;
+}
+
+void LatencyTracker::Submit()
+{
+    Mark(LATENCY_SUBMIT);
+#ifndef __APPLE__
+    if (HasGPUTimes()) {
+        // Keep the two clocks lined up; reading the GPU's clock doesn't
+        // wait for it to catch up
+        GLint64 gpuNow;
+        glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+        gpuOffset = gpuNow / 1.0e6 - Now();
+        
+        glQueryCounter(queries[frame % LATENCY_QUERY_FRAMES], GL_TIMESTAMP);
+    }
+#endif
+}
+
+void LatencyTracker::Swap()
+{
+    Mark(LATENCY_SWAP);
+    
+    // The slot this frame takes must be free: its last frame is read
+    // back now, waiting if the GPU is that far behind
+    if (frame - collected >= LATENCY_QUERY_FRAMES)
+        Collect(true);
+    
+    copy(current, current + LATENCY_STAMPS, pending[frame % LATENCY_QUERY_FRAMES]);
+    frame++;
+    fill(current, current + LATENCY_STAMPS, UNMARKED);
+    
+    Collect(false);
+}
+
+void LatencyTracker::Collect(bool wait)
+{
+    while (collected < frame) {
+        double *stamps = pending[collected % LATENCY_QUERY_FRAMES];
+        
+#ifndef __APPLE__
+        if (HasGPUTimes()) {
+            GLuint query = queries[collected % LATENCY_QUERY_FRAMES];
+            GLint available = 0;
+            glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available && !wait)
+                return;
+            GLuint64 gpuTime;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &gpuTime);
+            stamps[LATENCY_GPU] = gpuTime / 1.0e6 - gpuOffset;
+        }
+#endif
+        wait = false;
+        collected++;
+        
+        // Frames that missed a stamp (no sensor, no simulation step)
+        // still count for the stages they have
+        for (int stage = 0; stage < LATENCY_STAGES; stage++) {
+            double from = stamps[stageTable[stage].from];
+            double to = stamps[stageTable[stage].to];
+            if (from > UNMARKED && to > UNMARKED)
+                stages[stage].Add(to - from);
+        }
+    }
+}
+
+/** Prints a histogram of the samples kept, in buckets of a fixed width
+    from 0 up to the 99th percentile, with anything above in the last */
+static void printHistogram(const FrameStats& stats, ostream& out)
+{
+    const int buckets = 10;
+    const int width = 40;
+    
+    double top = max(stats.GetPercentile(0.99), 0.001);
+    double bucket = top / buckets;
+    int counts[buckets + 1] = { 0 };
+    for (size_t i = 0; i < stats.GetSampleCount(); i++) {
+        int index = (int) floor(max(stats.GetSample(i), 0.0) / bucket);
+        counts[min(index, buckets)]++;
+    }
+    
+    int most = *max_element(counts, counts + buckets + 1);
+    for (int i = 0; i <= buckets; i++) {
+        out << "    " << setw(7) << fixed << setprecision(2) << i * bucket
+            << (i < buckets ? " ms " : "+ms ") << setw(6) << counts[i] << " "
+            << string(most ? counts[i] * width / most : 0, '#') << endl;
+    }
+    out.unsetf(ios::fixed);
+    out << setprecision(6);
+}
+
+void LatencyTracker::Report(ostream& out) const
+{
+    out << "Latency (" << collected << " frames";
+    if (!HasGPUTimes())
+        out << ", no GPU timer queries";
+    out << "):" << endl;
+    
+    for (int stage = 0; stage < LATENCY_STAGES; stage++) {
+        if (!stages[stage].GetCount())
+            continue;
+        stages[stage].Report(string("  ") + stageTable[stage].name, out);
+        printHistogram(stages[stage], out);
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#ifdef __APPLE__
+#include <GLUT/glut.h>
+#else
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <GL/glut.h>
+#endif
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "FrameStats.h"
+
+/* Frames a GPU timestamp may take to come back before reading it
+   waits for the GPU */
+#define LATENCY_QUERY_FRAMES 4
+
+/** Points in a frame's life, in order */
+enum LatencyStamp
+{
+    LATENCY_SENSOR,      // the head orientation the frame shows was sampled
+    LATENCY_SIMULATION,  // the frame's simulation started
+    LATENCY_SUBMIT,      // the last draw call was issued
+    LATENCY_GPU,         // the GPU finished drawing
+    LATENCY_SWAP,        // the buffer swap returned
+    LATENCY_STAMPS
+};
+
+/* Stages reported; the last is the whole motion to photon latency */
+#define LATENCY_STAGES 5
+
+/** Motion-to-photon latency, broken down by stage.
+
+    Each frame carries a chain of timestamps, from the sensor sample
+    it shows to its buffer swap. GPU completion comes from a timestamp
+    query issued at submit, read back a few frames later without
+    stalling; where timer queries are missing that stage is left out.
+    Stages are collected over the run and printed as histograms. */
+class LatencyTracker
+{
+public:
+    LatencyTracker();
+    ~LatencyTracker();
+    
+    /** Marks a point in the current frame as now, or the given number
+        of milliseconds ago. Marking again replaces the earlier time
+        (the latest sensor read is the one shown). */
+    void Mark(LatencyStamp stamp, double ago = 0);
+    
+    /** Marks the submit, and queries the GPU for when it gets there */
+    void Submit();
+    
+    /** Marks the swap, and closes the frame */
+    void Swap();
+    
+    /** Returns whether GPU completion times are measured */
+    bool HasGPUTimes() const { return queries[0] != 0; }
+    
+    /** Returns the sensor to swap latencies seen so far */
+    const FrameStats& GetTotal() const { return stages[LATENCY_STAGES - 1]; }
+    
+    /** Prints each stage's histogram */
+    void Report(std::ostream& out = std::cout) const;
+    
+private:
+    /** Milliseconds from the tracker's creation */
+    double Now() const;
+    
+    /** Adds finished frames' stages to the statistics */
+    void Collect(bool wait);
+    
+    std::chrono::steady_clock::time_point created;
+    
+    /** The frame being timed, and frames waiting for their GPU time */
+    double current[LATENCY_STAMPS];
+    double pending[LATENCY_QUERY_FRAMES][LATENCY_STAMPS];
+    GLuint queries[LATENCY_QUERY_FRAMES];
+    
+    /** GPU clock minus CPU clock, in milliseconds */
+    double gpuOffset;
+    
+    long frame;
+    long collected;
+    
+    FrameStats stages[LATENCY_STAGES];
+};
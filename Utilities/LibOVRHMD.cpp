@@ -0,0 +1,50 @@
+#include "LibOVRHMD.h"
+
+#if HMD_LIBOVR
+
+LibOVRHMD::LibOVRHMD()
+{
+    OVR::System::Init();
+    
+    manager = *OVR::DeviceManager::Create();
+    
+    device = *manager->EnumerateDevices<OVR::HMDDevice>().CreateDevice();
+    if (device) {
+        sensor = *device->GetSensor();
+    }
+    else {
+        sensor = *manager->EnumerateDevices<OVR::SensorDevice>().CreateDevice();
+    }
+    
+    if (sensor) {
+        fusion.AttachToSensor(sensor);
+    }
+}
+
+LibOVRHMD::~LibOVRHMD()
+{
+    sensor.Clear();
+    device.Clear();
+    manager.Clear();
+    
+    OVR::System::Destroy();
+}
+
+bool LibOVRHMD::GetInfo(OVR::HMDInfo& info)
+{
+    return device && device->GetDeviceInfo(&info);
+}
+
+bool LibOVRHMD::HasSensor() const
+{
+    return sensor.GetPtr() != NULL;
+}
+
+glm::quat LibOVRHMD::GetOrientation()
+{
+    // LibOVR is y up
+    OVR::Quatf f = fusion.GetOrientation();
+    return glm::quat(f.w, f.x, -f.z, f.y);
+}
+
+#endif
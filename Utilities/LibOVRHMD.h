@@ -0,0 +1,27 @@
+#pragma once
+
+#include "HMD.h"
+
+#if HMD_LIBOVR
+
+/** An Oculus Rift found through LibOVR's device manager, with its
+    orientation from sensor fusion */
+class LibOVRHMD : public HMD
+{
+public:
+    LibOVRHMD();
+    ~LibOVRHMD();
+    
+    const char *GetName() const { return "LibOVR"; }
+    bool GetInfo(OVR::HMDInfo& info);
+    bool HasSensor() const;
+    glm::quat GetOrientation();
+    
+private:
+    OVR::Ptr<OVR::DeviceManager> manager;
+    OVR::Ptr<OVR::HMDDevice> device;
+    OVR::Ptr<OVR::SensorDevice> sensor;
+    OVR::SensorFusion fusion;
+};
+
+#endif
@@ -1,9 +1,25 @@
 #pragma once
 
+#include <stdint.h>
+
 #include "Texture.h"
 
+/* Default seed and size (must be a power of 2) */
+#define NOISE_SEED 248
+#define NOISE_SIZE 1024
+
+/* Number of points in a path from pathGen */
+#define PATH_SIZE 1024
+
 class Noise : public Texture
 {
 public:
-    Noise();
+    /** Generates a size x size diamond square texture. The same
+        seed always gives the same texture. */
+    Noise(uint32_t seed = NOISE_SEED, int size = NOISE_SIZE);
 };
+
+/** Random path generation, by midpoint displacement. Returns PATH_SIZE
+    offsets (roughly 0 to 1), one per evenly spaced step along the path.
+    The same seed always gives the same path. Free with delete[]. */
+float *pathGen(uint32_t seed);
@@ -0,0 +1,134 @@
+#include "NormalMap.h"
+
+#include <cmath>
+
+#include "FBO.h"
+#include "Program.h"
+#include "Screen.h"
+#include "Trace.h"
+
+/* Rows per task when splitting across threads */
+#define ROWS_PER_TASK 16
+
+using namespace std;
+using namespace glm;
+
+/** Encodes the normal of a pixel with height differences dx, dy.
+    Normal coordinates can be from -1 to 1, so they are
+    moved to the range 0 to 1 first. */
+static inline void encodeNormal(float dx, float dy, unsigned char *bgr)
+{
+    // normalize(cross(vec3(1, 0, a), vec3(0, 1, b))) == normalize(-a, -b, 1)
+    float a = NORMAL_MAP_STRENGTH * dx;
+    float b = NORMAL_MAP_STRENGTH * dy;
+    float inv = 1.0f / sqrtf(a * a + b * b + 1.0f);
+    bgr[0] = (unsigned char) (255 * (inv * 0.5f + 0.5f));
+    bgr[1] = (unsigned char) (255 * (-b * inv * 0.5f + 0.5f));
+    bgr[2] = (unsigned char) (255 * (-a * inv * 0.5f + 0.5f));
+}
+
+void NormalMap::Generate(const HeightField<float>& heights, bitmap_image& image,
+                         ThreadPool& pool)
+{
+    TRACE_SCOPE("load", "Generate normals");
+    int width = heights.GetWidth();
+
+    pool.ParallelFor(heights.GetHeight(), ROWS_PER_TASK, [&](size_t begin, size_t end) {
+        for (int y = (int) begin; y < (int) end; y++) {
+            // The height field's border makes the neighbours of
+            // edge pixels valid, so no wrapping is needed here
+            const float *up = heights.GetRow(y - 1);
+            const float *row = heights.GetRow(y);
+            const float *down = heights.GetRow(y + 1);
+            unsigned char *out = image.row(y);
+
+            int x = 0;
+#ifdef __SSE2__
+            const __m128 half = _mm_set1_ps(0.5f);
+            const __m128 one = _mm_set1_ps(1.0f);
+            const __m128 scale = _mm_set1_ps(255.0f);
+            const __m128 strength = _mm_set1_ps(NORMAL_MAP_STRENGTH);
+
+            for (; x + 4 <= width; x += 4) {
+                // Approximate gradient
+                __m128 dx = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(row + x + 1), _mm_loadu_ps(row + x - 1)), half);
+                __m128 dy = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(down + x), _mm_loadu_ps(up + x)), half);
+                __m128 a = _mm_mul_ps(strength, dx);
+                __m128 b = _mm_mul_ps(strength, dy);
+
+                __m128 length = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, a), _mm_mul_ps(b, b)), one);
+                __m128 inv = _mm_div_ps(one, _mm_sqrt_ps(length));
+                __m128 nx = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), a), inv);
+                __m128 ny = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), b), inv);
+
+                int32_t red[4], green[4], blue[4];
+                _mm_storeu_si128((__m128i *) red, _mm_cvttps_epi32(_mm_mul_ps(scale, _mm_add_ps(_mm_mul_ps(nx, half), half))));
+                _mm_storeu_si128((__m128i *) green, _mm_cvttps_epi32(_mm_mul_ps(scale, _mm_add_ps(_mm_mul_ps(ny, half), half))));
+                _mm_storeu_si128((__m128i *) blue, _mm_cvttps_epi32(_mm_mul_ps(scale, _mm_add_ps(_mm_mul_ps(inv, half), half))));
+
+                unsigned char *pixel = out + 3 * x;
+                for (int i = 0; i < 4; i++) {
+                    pixel[3 * i + 0] = (unsigned char) blue[i];
+                    pixel[3 * i + 1] = (unsigned char) green[i];
+                    pixel[3 * i + 2] = (unsigned char) red[i];
+                }
+            }
+#endif
+            for (; x < width; x++) {
+                encodeNormal((row[x + 1] - row[x - 1]) / 2.0f,
+                             (down[x] - up[x]) / 2.0f,
+                             out + 3 * x);
+            }
+        }
+    });
+}
+
+NormalMap::NormalMap(const HeightField<float>& heights, ThreadPool *pool)
+{
+    width = heights.GetWidth();
+    height = heights.GetHeight();
+    format = GL_RGB;
+    storage = GL_RGB8;
+    data = NULL;
+    bitmap = new bitmap_image(width, height);
+    Generate(heights, *bitmap, pool ? *pool : ThreadPool::Default());
+
+    glGenTextures(1, &id);
+    Bind();
+}
+
+NormalMap::NormalMap(Texture *heightMap)
+: Texture(heightMap->GetWidth(), heightMap->GetHeight(), GL_RGBA)
+{
+    Program program("Shaders/normals.vert", "Shaders/normals.frag");
+    Screen screen;
+    FBO frameBuffer(width, height);
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    // Render the normals straight into this texture
+    frameBuffer.Use();
+    frameBuffer.SetColorTexture(this, GL_COLOR_ATTACHMENT0);
+    glViewport(0, 0, (GLsizei) width, (GLsizei) height);
+
+    program.Use();
+    program.SetUniform("heightMap", heightMap, GL_TEXTURE0);
+    program.SetUniform("texelSize", vec2(1.0f / width, 1.0f / height));
+    program.SetUniform("strength", NORMAL_MAP_STRENGTH);
+    screen.Draw(program);
+
+    frameBuffer.Unuse();
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glDeleteProgram(program.GetID());
+}
+
+bool NormalMap::Save(const std::string& filename)
+{
+    if (!bitmap) {
+        cerr << "Warning: only normal maps built on the CPU can be saved" << endl;
+        return false;
+    }
+    bitmap->save_image(filename);
+    return true;
+}
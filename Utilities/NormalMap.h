@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Texture.h"
+#include "HeightField.hpp"
+#include "ThreadPool.h"
+
+/** Scale applied to height differences before building normals */
+#define NORMAL_MAP_STRENGTH 70.0f
+
+/** A normal map built from a height map, with central differences.
+
+    The CPU path splits the image into bands of rows across a thread
+    pool and does four pixels at a time with SSE2. The GPU path renders
+    the normals into the texture through an FBO. Neither writes to disk
+    unless Save is called. */
+class NormalMap : public Texture
+{
+public:
+    /** Builds the normal map on the CPU. Without a pool, the
+        default thread pool is used. */
+    NormalMap(const HeightField<float>& heights, ThreadPool *pool = NULL);
+
+    /** Builds the normal map on the GPU from a height map texture */
+    NormalMap(Texture *heightMap);
+
+    /** Writes the normal map to a bitmap file. Only available
+        for normal maps built on the CPU. */
+    bool Save(const std::string& filename);
+
+    /** Fills image (which must match the height field's size) with
+        normals encoded as colors. Does not touch OpenGL. */
+    static void Generate(const HeightField<float>& heights, bitmap_image& image,
+                         ThreadPool& pool);
+};
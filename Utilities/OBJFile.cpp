@@ -1,4 +1,5 @@
 #include "OBJFile.h"
+#include "Trace.h"
 
 #include <fstream>
 #include <sstream>
@@ -116,6 +117,7 @@ map<size_t, vector<size_t> > getNormalIndices(const vector<VertexIndex>& vertexI
 /** Parses a .obj file */
 OBJFile::OBJFile(const char *filename)
 {
+    TRACE_SCOPE("load", "Parse OBJ");
     vector<vec3> vertCoords;
     vector<vec2> texCoords;
     vector<vec3> normals;
@@ -1,57 +1,65 @@
 #include "Oculus.h"
+#include "SensorThread.h"
+
+#include <chrono>
+#include <fstream>
 
 using namespace::std;
 using namespace::OVR::Util::Render;
 
 namespace Oculus
 {
-    OVR::Ptr<OVR::DeviceManager>	pManager;
-    OVR::Ptr<OVR::HMDDevice>		pHMD;
-    OVR::Ptr<OVR::SensorDevice>     pSensor;
-    OVR::SensorFusion               FusionResult;
+    HMD                             *Device;
+    SensorThread                    *Sensor;
+    double                          LastPoseTime;
     OVR::HMDInfo                    Info;
     OVR::Util::Render::StereoConfig Stereo;
     float                           RenderScale;
     bool                            InfoLoaded;
+    ofstream                        Recording;
+    chrono::steady_clock::time_point RecordingStart;
     
-    void Init()
+    void Init(const string& backend)
     {
-        OVR::System::Init();
-        
-        pManager = *OVR::DeviceManager::Create();
-        
-        pHMD = *pManager->EnumerateDevices<OVR::HMDDevice>().CreateDevice();
-        
-        if (pHMD)
-        {
-            InfoLoaded = pHMD->GetDeviceInfo(&Info);
-            pSensor = *pHMD->GetSensor();
+        if (!backend.empty()) {
+            Device = HMD::Create(backend);
         }
-        else
+#if HMD_LIBOVR
+        else {
+            Device = HMD::Create("ovr");
+        }
+#endif
+        
+        if (Device)
         {
-            pSensor = *pManager->EnumerateDevices<OVR::SensorDevice>().CreateDevice();
+            InfoLoaded = Device->GetInfo(Info);
         }
         
-        if (pSensor)
+        if (HasOrientation())
         {
-            FusionResult.AttachToSensor(pSensor);
+            Sensor = new SensorThread(Device);
         }
     }
 
     void Clear()
     {
-        pSensor.Clear();
-        pHMD.Clear();
-        pManager.Clear();
-        
-        OVR::System::Destroy();
+        delete Sensor;
+        Sensor = NULL;
+        delete Device;
+        Device = NULL;
+        Recording.close();
     }
 
     void Output()
     {
         cout << "----- Oculus Console -----" << endl;
         
-        if (pHMD)
+        if (Device)
+        {
+            cout << " Backend: " << Device->GetName() << endl;
+        }
+        
+        if (InfoLoaded)
         {
             cout << " [x] HMD Found" << endl;
         }
@@ -60,7 +68,7 @@ namespace Oculus
             cout << " [ ] HMD Not Found" << endl;
         }
         
-        if (pSensor)
+        if (HasOrientation())
         {
             cout << " [x] Sensor Found" << endl;
         }
@@ -94,10 +102,10 @@ namespace Oculus
     
     void UpdateStereoConfig(float win_width, float win_height)
     {
-        if (pHMD) {
+        if (InfoLoaded) {
             // Obtain setup data from the HMD and initialize StereoConfig
             // for stereo rendering.
-            pHMD->GetDeviceInfo(&Info);
+            Device->GetInfo(Info);
             Stereo.SetFullViewport(Viewport(0,0, win_width, win_height));
             Stereo.SetStereoMode(Stereo_LeftRight_Multipass);
             Stereo.SetHMDInfo(Info);
@@ -116,10 +124,43 @@ namespace Oculus
         return InfoLoaded;
     }
     
-    glm::quat GetOrientation()
+    bool HasOrientation()
     {
-        OVR::Quatf f = FusionResult.GetOrientation();
-        return glm::quat(f.w, f.x, -f.z, f.y);
+        return Device && Device->HasSensor();
+    }
+    
+    void Record(const string& path)
+    {
+        Recording.open(path.c_str());
+        if (!Recording) {
+            cerr << "Warning: unable to record the sensor to " << path << endl;
+            return;
+        }
+        RecordingStart = chrono::steady_clock::now();
+        Recording << "# seconds w x y z" << endl;
+    }
+    
+    double GetSampleAge()
+    {
+        return Sensor ? (Sensor->Now() - LastPoseTime) * 1000.0 : 0;
+    }
+    
+    glm::quat GetOrientation(double prediction)
+    {
+        if (!Sensor)
+            return glm::quat();
+        
+        Pose pose = Sensor->GetPose();
+        LastPoseTime = pose.time;
+        if (Recording.is_open()) {
+            chrono::duration<double> t = chrono::steady_clock::now() - RecordingStart;
+            Recording << t.count() << " " << pose.orientation.w << " " << pose.orientation.x << " "
+                      << pose.orientation.y << " " << pose.orientation.z << "\n";
+        }
+        
+        if (prediction > 0)
+            return SensorThread::Predict(pose, Sensor->Now() + prediction / 1000.0);
+        return pose.orientation;
     }
     
     float GetScreenWidth()
@@ -1,15 +1,18 @@
 #pragma once
 
 #include <iostream>
+#include <string>
 #include <glm/gtc/quaternion.hpp>
 #include "../LibOVR/Include/OVR.h"
 #include "Util_Render_Stereo.h"
+#include "HMD.h"
 
 namespace Oculus
 {
     // Init should be placed into the initialization sequence, before
-    // any other Oculus calls
-    void Init();
+    // any other Oculus calls. backend selects the HMD (see HMD::Create);
+    // by default a Rift is looked for through LibOVR, where available.
+    void Init(const std::string& backend = "");
     
     // Clear is a cleanup function to be placed at the end of
     // program executions and takes care of cleaning up Oculus related
@@ -22,6 +25,16 @@ namespace Oculus
     // Returns whether or not Oculus data was successfully loaded
     bool IsInfoLoaded();
     
+    // Returns whether GetOrientation follows a head, real or simulated
+    bool HasOrientation();
+    
+    // Returns how old the last orientation read was, in milliseconds
+    double GetSampleAge();
+    
+    // Logs every orientation read to a file, in the format the replay
+    // backend plays back
+    void Record(const std::string& path);
+    
     // StereoConfig is an internal class that computes view and
     // distortion information. It needs to know the current window
     // width and window height, so UpdateStereoConfig should be
@@ -32,7 +45,10 @@ namespace Oculus
     // Returns the distortion information for the current view
     const OVR::Util::Render::DistortionConfig& GetDistortionConfig();
     
-    glm::quat GetOrientation();
+    // Returns the newest orientation from the sensor thread, or one
+    // extrapolated the given number of milliseconds past now. Doesn't
+    // lock; see SensorThread.
+    glm::quat GetOrientation(double prediction = 0);
     float GetScreenWidth();
     float GetScreenHeight();
     float GetLensSeparationDistance();
@@ -0,0 +1,184 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+/* Section time not measured */
+static const float UNMEASURED = -1.0f;
+
+static thread_local Profiler *current = NULL;
+
+Profiler::Profiler(const string& name)
+: name(name), created(chrono::steady_clock::now()), sectionCount(0),
+  depth(0), gpuOpen(-1), frame(0), collected(0), filed(0)
+{
+    for (int i = 0; i < PROFILER_QUERY_FRAMES; i++) {
+        pending[i].frame = i;
+        fill(pending[i].cpu, pending[i].cpu + PROFILER_SECTIONS, UNMEASURED);
+        fill(pending[i].gpu, pending[i].gpu + PROFILER_SECTIONS, UNMEASURED);
+        fill(queried[i], queried[i] + PROFILER_SECTIONS, false);
+        fill(queries[i], queries[i] + PROFILER_SECTIONS, 0);
+    }
+#ifndef __APPLE__
+    if (GLEW_ARB_timer_query) {
+        glGenQueries(PROFILER_QUERY_FRAMES * PROFILER_SECTIONS, &queries[0][0]);
+    }
+#endif
+}
+
+Profiler::~Profiler()
+{
+    if (current == this)
+        current = NULL;
+    if (HasGPUTimes())
+        glDeleteQueries(PROFILER_QUERY_FRAMES * PROFILER_SECTIONS, &queries[0][0]);
+}
+
+Profiler *Profiler::GetCurrent()
+{
+    return current;
+}
+
+void Profiler::SetCurrent(Profiler *profiler)
+{
+    current = profiler;
+}
+
+double Profiler::Now() const
+{
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - created;
+    return elapsed.count();
+}
+
+int Profiler::FindSection(const char *section)
+{
+    for (int i = 0; i < sectionCount; i++) {
+        if (sections[i] == section || strcmp(sections[i], section) == 0)
+            return i;
+    }
+    if (sectionCount == PROFILER_SECTIONS)
+        return -1;
+    sections[sectionCount] = section;
+    return sectionCount++;
+}
+
+void Profiler::Begin(const char *section, bool gpu)
+{
+    // Scopes past the deepest nesting are still counted, so that
+    // their ends match, but not timed
+    int index = (depth < PROFILER_SECTIONS) ? FindSection(section) : -1;
+    if (depth < PROFILER_SECTIONS) {
+        open[depth] = index;
+        openStart[depth] = Now();
+    }
+
+#ifndef __APPLE__
+    if (gpu && index >= 0 && gpuOpen < 0 && HasGPUTimes()) {
+        int slot = frame % PROFILER_QUERY_FRAMES;
+        glBeginQuery(GL_TIME_ELAPSED, queries[slot][index]);
+        queried[slot][index] = true;
+        gpuOpen = depth;
+    }
+#endif
+    depth++;
+}
+
+void Profiler::End()
+{
+    if (depth == 0)
+        return;
+    depth--;
+
+#ifndef __APPLE__
+    if (gpuOpen == depth) {
+        glEndQuery(GL_TIME_ELAPSED);
+        gpuOpen = -1;
+    }
+#endif
+
+    if (depth < PROFILER_SECTIONS && open[depth] >= 0) {
+        float& time = pending[frame % PROFILER_QUERY_FRAMES].cpu[open[depth]];
+        time = max(time, 0.0f) + (float) (Now() - openStart[depth]);
+    }
+}
+
+void Profiler::EndFrame()
+{
+    frame++;
+
+    // The slot the next frame takes must be free; a GPU that far
+    // behind loses those times rather than stalling the frame
+    if (frame - collected >= PROFILER_QUERY_FRAMES)
+        Collect(true);
+    Collect(false);
+}
+
+void Profiler::Flush()
+{
+    glFinish();
+    while (collected < frame)
+        Collect(true);
+}
+
+void Profiler::Collect(bool force)
+{
+    while (collected < frame) {
+        int slot = collected % PROFILER_QUERY_FRAMES;
+        ProfileFrame& times = pending[slot];
+
+#ifndef __APPLE__
+        // Only the newest result need be checked: queries finish in order
+        int last = -1;
+        for (int i = 0; i < sectionCount; i++) {
+            if (queried[slot][i])
+                last = i;
+        }
+        GLint available = 1;
+        if (last >= 0) {
+            glGetQueryObjectiv(queries[slot][last], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available && !force)
+                return;
+        }
+        for (int i = 0; i < sectionCount; i++) {
+            if (queried[slot][i] && available) {
+                GLuint64 elapsed;
+                glGetQueryObjectui64v(queries[slot][i], GL_QUERY_RESULT, &elapsed);
+                times.gpu[i] = (float) (elapsed / 1.0e6);
+            }
+            queried[slot][i] = false;
+        }
+#endif
+        force = false;
+
+        history[collected % PROFILER_HISTORY] = times;
+        collected++;
+        filed.store(collected, memory_order_release);
+
+        // Ready the slot for the frame that takes it next
+        times.frame = collected + PROFILER_QUERY_FRAMES - 1;
+        fill(times.cpu, times.cpu + PROFILER_SECTIONS, UNMEASURED);
+        fill(times.gpu, times.gpu + PROFILER_SECTIONS, UNMEASURED);
+    }
+}
+
+void Profiler::WriteCSV(ostream& out, bool header) const
+{
+    if (header)
+        out << "profiler,frame,section,cpu_ms,gpu_ms" << endl;
+
+    long last = GetFrameCount();
+    for (long i = max(last - PROFILER_HISTORY, 0L); i < last; i++) {
+        const ProfileFrame& times = GetFrame(i);
+        for (int section = 0; section < sectionCount; section++) {
+            if (times.cpu[section] == UNMEASURED && times.gpu[section] == UNMEASURED)
+                continue;
+            out << name << "," << times.frame << "," << sections[section] << ","
+                << times.cpu[section] << ",";
+            if (times.gpu[section] != UNMEASURED)
+                out << times.gpu[section];
+            out << endl;
+        }
+    }
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#ifdef __APPLE__
+#include <GLUT/glut.h>
+#else
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <GL/glut.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "Trace.h"
+
+/* Set to 0 to compile the profiling scopes out entirely */
+#ifndef ENABLE_PROFILING
+#define ENABLE_PROFILING 1
+#endif
+
+/* Most sections a profiler tracks, frames of results it keeps, and
+   frames a GPU time may take to come back before it is given up on */
+#define PROFILER_SECTIONS 8
+#define PROFILER_HISTORY 512
+#define PROFILER_QUERY_FRAMES 3
+
+/** One frame's times for each section, in milliseconds. A section
+    not run that frame, or whose GPU time never came back, is -1. */
+struct ProfileFrame
+{
+    long frame;
+    float cpu[PROFILER_SECTIONS];
+    float gpu[PROFILER_SECTIONS];
+};
+
+/** Frame timing by section, on the CPU and (with timer queries) on
+    the GPU.
+
+    Sections are named code regions, timed with the PROFILE_SCOPE and
+    PROFILE_GPU_SCOPE macros. GPU times come from GL_TIME_ELAPSED
+    queries, a set per frame in flight, read back PROFILER_QUERY_FRAMES
+    frames later only if they are ready, so timing never stalls.
+    Elapsed time queries can't nest, so a GPU scope inside another is
+    timed on the CPU only. A section run more than once a frame adds
+    up.
+
+    Each thread that draws has its own profiler, made current with
+    SetCurrent; its queries belong to that thread's context. Finished
+    frames go into a ring of the last PROFILER_HISTORY frames, which
+    other threads may read without locking (for the overlay) as long
+    as they stay well behind the newest frame. */
+class Profiler
+{
+public:
+    Profiler(const std::string& name);
+    ~Profiler();
+
+    /** Returns the calling thread's profiler, or NULL */
+    static Profiler *GetCurrent();
+
+    /** Makes the profiler the calling thread's (NULL for none) */
+    static void SetCurrent(Profiler *profiler);
+
+    /** Starts and stops timing a section; the name must be a string
+        literal, as only its pointer is kept */
+    void Begin(const char *section, bool gpu);
+    void End();
+
+    /** Closes the frame, and files any earlier frames whose GPU times
+        are in */
+    void EndFrame();
+
+    /** Waits for the GPU and files every closed frame, for reading
+        the times of a run that has ended */
+    void Flush();
+
+    const std::string& GetName() const { return name; }
+
+    /** Returns whether GPU times are measured */
+    bool HasGPUTimes() const { return queries[0][0] != 0; }
+
+    /** Section names, in the order they were first seen */
+    int GetSectionCount() const { return sectionCount; }
+    const char *GetSectionName(int section) const { return sections[section]; }
+
+    /** Returns the number of frames filed so far; the last
+        PROFILER_HISTORY of them can be read with GetFrame */
+    long GetFrameCount() const { return filed.load(std::memory_order_acquire); }
+    const ProfileFrame& GetFrame(long frame) const { return history[frame % PROFILER_HISTORY]; }
+
+    /** Writes the frames kept as CSV: one row per profiler, frame and
+        section, with the CPU and GPU milliseconds */
+    void WriteCSV(std::ostream& out, bool header = true) const;
+
+private:
+    /** Milliseconds from the profiler's creation */
+    double Now() const;
+
+    /** Returns the section's index, adding it if it is new (or -1
+        when there is no room) */
+    int FindSection(const char *section);
+
+    /** Files finished frames, oldest first, up to the first whose GPU
+        times aren't in; force files that one anyway, without them */
+    void Collect(bool force);
+
+    std::string name;
+    std::chrono::steady_clock::time_point created;
+
+    const char *sections[PROFILER_SECTIONS];
+    std::atomic<int> sectionCount;
+
+    /** Sections open on the CPU, innermost last, with when they
+        started; and the depth of the scope with a GPU query
+        running, or -1 */
+    int open[PROFILER_SECTIONS];
+    double openStart[PROFILER_SECTIONS];
+    int depth;
+    int gpuOpen;
+
+    /** Frames in flight: their CPU times, and a query per section */
+    ProfileFrame pending[PROFILER_QUERY_FRAMES];
+    bool queried[PROFILER_QUERY_FRAMES][PROFILER_SECTIONS];
+    GLuint queries[PROFILER_QUERY_FRAMES][PROFILER_SECTIONS];
+    long frame;
+    long collected;
+
+    ProfileFrame history[PROFILER_HISTORY];
+    std::atomic<long> filed;
+};
+
+/** Times the rest of the enclosing block as a section of the current
+    thread's profiler, and traces it as a span */
+class ProfileScope
+{
+public:
+    ProfileScope(const char *section, bool gpu)
+    : trace(gpu ? "gpu pass" : "pass", section), profiler(Profiler::GetCurrent())
+    {
+        if (profiler)
+            profiler->Begin(section, gpu);
+    }
+
+    ~ProfileScope()
+    {
+        if (profiler)
+            profiler->End();
+    }
+
+private:
+    TraceScope trace;
+    Profiler *profiler;
+};
+
+#if ENABLE_PROFILING
+#define PROFILE_CONCATENATE(a, b) a##b
+#define PROFILE_NAME(line) PROFILE_CONCATENATE(profileScope, line)
+#define PROFILE_SCOPE(section) ProfileScope PROFILE_NAME(__LINE__)(section, false)
+#define PROFILE_GPU_SCOPE(section) ProfileScope PROFILE_NAME(__LINE__)(section, true)
+#define PROFILE_END_FRAME() do { if (Profiler::GetCurrent()) Profiler::GetCurrent()->EndFrame(); } while (0)
+#else
+#define PROFILE_SCOPE(section) TRACE_SCOPE("pass", section)
+#define PROFILE_GPU_SCOPE(section) TRACE_SCOPE("gpu pass", section)
+#define PROFILE_END_FRAME() do {} while (0)
+#endif
@@ -0,0 +1,106 @@
+#include "ProfilerOverlay.h"
+
+#include <algorithm>
+
+using namespace std;
+
+/* Section colours, in order of first appearance */
+static const GLfloat colors[PROFILER_SECTIONS][3] = {
+    { 0.9f, 0.3f, 0.2f },
+    { 0.2f, 0.8f, 0.3f },
+    { 0.3f, 0.5f, 1.0f },
+    { 1.0f, 0.8f, 0.2f },
+    { 0.8f, 0.3f, 0.9f },
+    { 0.2f, 0.9f, 0.9f },
+    { 1.0f, 0.5f, 0.1f },
+    { 0.7f, 0.7f, 0.7f },
+};
+
+ProfilerOverlay::ProfilerOverlay(double budget)
+: budget(budget)
+{
+}
+
+void ProfilerOverlay::Draw(const Profiler& profiler, int x, int y, int width, int height) const
+{
+    glPushAttrib(GL_ENABLE_BIT | GL_VIEWPORT_BIT | GL_CURRENT_BIT);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_TEXTURE_2D);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glUseProgram(0);
+    glViewport(x, y, width, height);
+
+    // The graph spans -1 to 1 in both directions
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    // Backdrop
+    glColor4f(0.0f, 0.0f, 0.0f, 0.6f);
+    glRectf(-1.0f, -1.0f, 1.0f, 1.0f);
+
+    DrawBars(profiler, false);
+    if (profiler.HasGPUTimes())
+        DrawBars(profiler, true);
+
+    // The middle line, and the budget above and below it
+    glBegin(GL_LINES);
+    glColor4f(1.0f, 1.0f, 1.0f, 0.8f);
+    glVertex2f(-1.0f, 0.0f);
+    glVertex2f(1.0f, 0.0f);
+    glColor4f(1.0f, 0.2f, 0.2f, 0.8f);
+    glVertex2f(-1.0f, 0.5f);
+    glVertex2f(1.0f, 0.5f);
+    glVertex2f(-1.0f, -0.5f);
+    glVertex2f(1.0f, -0.5f);
+    glEnd();
+
+    // Legend, in the section colours
+    for (int section = 0; section < profiler.GetSectionCount(); section++) {
+        glColor3fv(colors[section]);
+        glRasterPos2f(-0.98f, 0.9f - section * 24.0f / height);
+        for (const char *c = profiler.GetSectionName(section); *c; c++)
+            glutBitmapCharacter(GLUT_BITMAP_HELVETICA_10, *c);
+    }
+
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopAttrib();
+}
+
+void ProfilerOverlay::DrawBars(const Profiler& profiler, bool gpu) const
+{
+    // Leave the newest frames alone: the profiler may be filing
+    // them on another thread
+    long last = profiler.GetFrameCount() - 1;
+    long first = max(last - OVERLAY_FRAMES, 0L);
+    float barWidth = 2.0f / OVERLAY_FRAMES;
+    float scale = (float) (0.5 / budget) * (gpu ? -1.0f : 1.0f);
+
+    glBegin(GL_QUADS);
+    for (long frame = first; frame < last; frame++) {
+        const ProfileFrame& times = profiler.GetFrame(frame);
+        float left = 1.0f - (last - frame) * barWidth;
+        float bottom = 0.0f;
+        for (int section = 0; section < profiler.GetSectionCount(); section++) {
+            float time = gpu ? times.gpu[section] : times.cpu[section];
+            if (time <= 0.0f)
+                continue;
+            float top = bottom + time * scale;
+            top = gpu ? max(top, -1.0f) : min(top, 1.0f);
+            glColor4f(colors[section][0], colors[section][1], colors[section][2], 0.9f);
+            glVertex2f(left, bottom);
+            glVertex2f(left + barWidth, bottom);
+            glVertex2f(left + barWidth, top);
+            glVertex2f(left, top);
+            bottom = top;
+        }
+    }
+    glEnd();
+}
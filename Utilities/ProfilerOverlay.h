@@ -0,0 +1,37 @@
+#pragma once
+
+#ifdef __APPLE__
+#include <GLUT/glut.h>
+#else
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <GL/glut.h>
+#endif
+
+#include "Profiler.h"
+
+/* Frames shown across the graph */
+#define OVERLAY_FRAMES 120
+
+/** A small graph of a profiler's recent frames: a bar per frame with
+    the sections stacked in their own colours, CPU times above the
+    middle line and GPU times below it, against a line marking the
+    frame budget. Drawn with the fixed function pipeline straight into
+    the current framebuffer, on top of whatever is there. */
+class ProfilerOverlay
+{
+public:
+    /** budget is the frame time to mark, in milliseconds; bars are
+        scaled so twice the budget fills half the graph */
+    ProfilerOverlay(double budget);
+
+    /** Draws the graph into the given pixel rectangle */
+    void Draw(const Profiler& profiler, int x, int y, int width, int height) const;
+
+private:
+    /** Draws one half of the graph, growing up (CPU) or down (GPU)
+        from the middle line */
+    void DrawBars(const Profiler& profiler, bool gpu) const;
+
+    double budget;
+};
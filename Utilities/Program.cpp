@@ -3,6 +3,7 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <cstring>
 
 using namespace std;
 using namespace glm;
@@ -196,6 +197,14 @@ void Program::SetUniform(const char *name, const vec4& value) const
     glUniform4f(id, value.x, value.y, value.z, value.w);
 }
 
+void Program::SetUniform(const char *name, const mat3& value) const
+{
+    GLint id = GetUniformLocation(name);
+    if (id < 0)
+        return;
+    glUniformMatrix3fv(id, 1, false, &value[0][0]);
+}
+
 void Program::SetUniform(const char *name, const mat4& value) const
 {
     GLint id = GetUniformLocation(name);
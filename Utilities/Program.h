@@ -86,6 +86,7 @@ public:
     void SetUniform(const char *name, const glm::vec2& value) const;
     void SetUniform(const char *name, const glm::vec3& value) const;
     void SetUniform(const char *name, const glm::vec4& value) const;
+    void SetUniform(const char *name, const glm::mat3& value) const;
     void SetUniform(const char *name, const glm::mat4& value) const;
     void SetUniform(const char *name, Texture *texture, GLenum unit) const;
     
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+
+/** Counter-based random numbers (Widynski's "Squares" generator).
+
+    Every value is a pure function of a key and a counter, so values can
+    be computed in any order, on any thread, and still come out the
+    same. Use RandomKey to turn a seed into a key, and build counters
+    from whatever identifies the value (e.g. its coordinates). */
+
+/** Turns a seed into a well-mixed key (splitmix64 finalizer) */
+inline uint64_t RandomKey(uint64_t seed)
+{
+    uint64_t z = seed + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+    return z | 1;
+}
+
+/** Returns 32 random bits for the given counter and key */
+inline uint32_t RandomBits(uint64_t counter, uint64_t key)
+{
+    uint64_t x, y, z;
+    y = x = counter * key;
+    z = y + key;
+    x = x * x + y; x = (x >> 32) | (x << 32);
+    x = x * x + z; x = (x >> 32) | (x << 32);
+    x = x * x + y; x = (x >> 32) | (x << 32);
+    return (uint32_t) ((x * x + z) >> 32);
+}
+
+/** Returns a random float in [min, max) for the given counter and key */
+inline float RandomFloat(uint64_t counter, uint64_t key, float min, float max)
+{
+    // Top 24 bits give every float in [0, 1) with a 2^-24 spacing
+    float unit = (RandomBits(counter, key) >> 8) * (1.0f / 16777216.0f);
+    return min + unit * (max - min);
+}
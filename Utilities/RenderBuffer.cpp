@@ -1,4 +1,5 @@
 #include "RenderBuffer.h"
+#include "ResourceRegistry.h"
 
 RenderBuffer::RenderBuffer()
 {
@@ -14,11 +15,15 @@ RenderBuffer::RenderBuffer(float width, float height)
     glBindRenderbuffer(GL_RENDERBUFFER, id);
 	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, (GLsizei) width, (GLsizei) height);
     glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    
+    // The driver picks the depth; assume it rounds up to 32 bits
+    ResourceRegistry::Add(RESOURCE_RENDERBUFFER, id, (size_t) width * height * 4, "DEPTH");
 }
 
 RenderBuffer::~RenderBuffer()
 {
     glDeleteRenderbuffers(1, &id);
+    ResourceRegistry::Remove(RESOURCE_RENDERBUFFER, id);
 }
 
 GLuint RenderBuffer::GetID()
@@ -0,0 +1,78 @@
+#include "ReplayHMD.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+using namespace glm;
+
+ReplayHMD::ReplayHMD(const string& path)
+{
+    ifstream file(path.c_str());
+    if (!file) {
+        cerr << "Warning: unable to open sensor log " << path << endl;
+        return;
+    }
+    
+    string line;
+    while (getline(file, line)) {
+        istringstream fields(line.substr(0, line.find('#')));
+        fields >> ws;
+        if (fields.eof())
+            continue;
+        
+        // Samples start with a number, display settings with a name
+        if (!isalpha(fields.peek())) {
+            Sample sample;
+            fields >> sample.time >> sample.orientation.w >> sample.orientation.x
+                   >> sample.orientation.y >> sample.orientation.z;
+            if (fields.fail()) {
+                cerr << "Warning: bad sample \"" << line << "\" in " << path << endl;
+                continue;
+            }
+            sample.orientation = normalize(sample.orientation);
+            samples.push_back(sample);
+            continue;
+        }
+        
+        string key;
+        fields >> key;
+        if (!Configure(key, fields))
+            cerr << "Warning: unknown HMD setting " << key << " in " << path << endl;
+    }
+    
+    if (samples.empty()) {
+        cerr << "Warning: no samples in sensor log " << path << endl;
+        return;
+    }
+    
+    // Time from the first sample
+    double first = samples[0].time;
+    for (size_t i = 0; i < samples.size(); i++)
+        samples[i].time -= first;
+}
+
+quat ReplayHMD::GetOrientation()
+{
+    return GetOrientationAt(GetTime());
+}
+
+quat ReplayHMD::GetOrientationAt(double seconds) const
+{
+    double duration = samples.back().time;
+    if (duration <= 0)
+        return samples[0].orientation;
+    seconds = fmod(seconds, duration);
+    
+    // The first sample at or after the time, but never the first one
+    vector<Sample>::const_iterator next = lower_bound(samples.begin() + 1, samples.end() - 1, seconds,
+        [](const Sample& sample, double time) { return sample.time < time; });
+    const Sample& a = *(next - 1);
+    const Sample& b = *next;
+    float t = (b.time > a.time) ? (float) ((seconds - a.time) / (b.time - a.time)) : 0.0f;
+    return mix(a.orientation, b.orientation, std::min(std::max(t, 0.0f), 1.0f));
+}
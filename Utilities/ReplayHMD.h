@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "SyntheticHMD.h"
+
+/** Plays back a recorded sensor log, on the synthetic HMD's display.
+
+    The log has one sample per line, "seconds w x y z" (a quaternion
+    in the application's frame, as written by Oculus::Record), and may
+    contain SyntheticHMD configuration lines to describe the display.
+    Playback interpolates between samples and loops at the end. */
+class ReplayHMD : public SyntheticHMD
+{
+public:
+    ReplayHMD(const std::string& path);
+    
+    /** Returns whether the log had any samples */
+    bool IsLoaded() const { return !samples.empty(); }
+    
+    const char *GetName() const { return "replay"; }
+    glm::quat GetOrientation();
+    
+    /** Returns the recorded orientation at a time (in seconds) from
+        the start of the log */
+    glm::quat GetOrientationAt(double seconds) const;
+    
+private:
+    struct Sample
+    {
+        double time;
+        glm::quat orientation;
+    };
+    std::vector<Sample> samples;
+};
@@ -0,0 +1,60 @@
+#include "ResolutionScaler.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+ResolutionScaler::ResolutionScaler(double target, float minScale, float maxScale, float scale)
+: target(target), minScale(minScale), maxScale(maxScale),
+  scale(min(max(scale, minScale), maxScale)), smoothed(0), smoothedFixed(0), changes(0), settling(0),
+  scales(FRAME_STATS_HISTORY), times(FRAME_STATS_HISTORY), fixedTimes(FRAME_STATS_HISTORY)
+{
+}
+
+void ResolutionScaler::AddFrame(double scaledMilliseconds, double fixedMilliseconds)
+{
+    if (times.GetCount()) {
+        smoothed += RESOLUTION_SMOOTHING * (scaledMilliseconds - smoothed);
+        smoothedFixed += RESOLUTION_SMOOTHING * (fixedMilliseconds - smoothedFixed);
+    }
+    else {
+        smoothed = scaledMilliseconds;
+        smoothedFixed = fixedMilliseconds;
+    }
+    times.Add(scaledMilliseconds);
+    fixedTimes.Add(fixedMilliseconds);
+    
+    // What is left of the target once the work that doesn't scale is
+    // done; if that is nothing, the scale falls as fast as it may
+    double budget = max(target - smoothedFixed, 0.0);
+    double ratio = (smoothed > 0) ? budget / smoothed : 1;
+    if (settling > 0) {
+        settling--;
+    }
+    else if (ratio < 1 - RESOLUTION_DEADBAND || ratio > 1 + RESOLUTION_DEADBAND) {
+        // The scale that would just fit, if time went exactly with area
+        double wanted = scale * sqrt(ratio);
+        wanted = min(max(wanted, scale * (1 - RESOLUTION_MAX_DECREASE)),
+                     scale * (1 + RESOLUTION_MAX_INCREASE));
+        float next = min(max((float) wanted, minScale), maxScale);
+        if (next != scale) {
+            scale = next;
+            changes++;
+            settling = RESOLUTION_SETTLE_FRAMES;
+        }
+    }
+    scales.Add(scale);
+}
+
+void ResolutionScaler::Report(const string& name, ostream& out) const
+{
+    if (!scales.GetCount())
+        return;
+    out << name << " (" << minScale << " to " << maxScale << ", target "
+        << target << " ms GPU): mean scale " << scales.GetMean() << ", min "
+        << scales.GetMin() << ", max " << scales.GetMax() << ", "
+        << changes << " changes over " << scales.GetCount() << " frames" << endl;
+    times.Report("  GPU times at the scale", out);
+    fixedTimes.Report("  GPU times not scaled", out);
+}
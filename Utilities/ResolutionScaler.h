@@ -0,0 +1,72 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+
+#include "FrameStats.h"
+
+/* Weight of the newest frame's GPU time in the smoothed time */
+#define RESOLUTION_SMOOTHING 0.1
+
+/* How far the smoothed time may stray from the target, as a fraction
+   of it, before the scale is changed */
+#define RESOLUTION_DEADBAND 0.1
+
+/* Most the scale may fall or rise in one change, as a fraction of
+   it. It falls faster than it rises, as a dropped frame is worse than
+   a few soft ones. */
+#define RESOLUTION_MAX_DECREASE 0.1
+#define RESOLUTION_MAX_INCREASE 0.05
+
+/* Frames to wait after a change before judging the new scale: GPU
+   times come back a few frames late, and the smoothed time takes a
+   few more to follow them */
+#define RESOLUTION_SETTLE_FRAMES 8
+
+/** Picks the scale the eye buffers are rendered at from how long
+    the GPU took over recent frames, to keep each frame within a time
+    budget. The time is smoothed, the scale only moves once it is
+    clearly over or under the budget, and each change is given time
+    to show in the times before the next, so it doesn't hunt.
+
+    The scale is linear: the pixels drawn, and so roughly the GPU
+    time, go with its square. Only the passes drawn at the scale are
+    judged that way; the rest of the frame's GPU work, such as the
+    window sized distortion, is taken off the budget they have. Feed
+    it one frame at a time, in order, with AddFrame. */
+class ResolutionScaler
+{
+public:
+    /** target is the GPU time to aim for per frame, in milliseconds */
+    ResolutionScaler(double target, float minScale, float maxScale, float scale = 1);
+    
+    /** Files a frame's GPU time in the passes drawn at the scale, and
+        in the rest of the frame */
+    void AddFrame(double scaledMilliseconds, double fixedMilliseconds = 0);
+    
+    float GetScale() const { return scale; }
+    float GetMinScale() const { return minScale; }
+    float GetMaxScale() const { return maxScale; }
+    
+    /** Returns the smoothed GPU time per frame in the scaled passes,
+        and in the rest, in milliseconds */
+    double GetSmoothedTime() const { return smoothed; }
+    double GetSmoothedFixedTime() const { return smoothedFixed; }
+    
+    /** Prints the target, and the scales and times seen */
+    void Report(const std::string& name, std::ostream& out = std::cout) const;
+    
+private:
+    double target;
+    float minScale;
+    float maxScale;
+    float scale;
+    
+    double smoothed;
+    double smoothedFixed;
+    long changes;
+    int settling;
+    FrameStats scales;
+    FrameStats times;
+    FrameStats fixedTimes;
+};
@@ -0,0 +1,177 @@
+#include "ResourceRegistry.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    /** One allocation */
+    struct Resource
+    {
+        size_t bytes;
+        const char *format;
+        string owner;
+    };
+
+    typedef pair<int, uintptr_t> ResourceKey;
+
+    const char *CategoryNames[RESOURCE_CATEGORIES] = {
+        "Textures", "Render targets", "Buffers", "Renderbuffers", "Framebuffers", "Images (CPU)"
+    };
+
+    mutex ResourcesMutex;
+    map<ResourceKey, Resource> Resources;
+    size_t Bytes[RESOURCE_CATEGORIES];
+    int Counts[RESOURCE_CATEGORIES];
+    size_t GPUBytes = 0, PeakGPUBytes = 0;
+    size_t Budget = 0;
+
+    thread_local const ResourceOwner *Owner = NULL;
+
+    const double Megabyte = 1024.0 * 1024.0;
+
+    bool IsOnGPU(int category)
+    {
+        return category != RESOURCE_IMAGE;
+    }
+}
+
+ResourceOwner::ResourceOwner(const char *name)
+: name(name), outer(Owner)
+{
+    Owner = this;
+}
+
+ResourceOwner::~ResourceOwner()
+{
+    Owner = outer;
+}
+
+namespace ResourceRegistry
+{
+    void Add(ResourceCategory category, uintptr_t handle, size_t bytes,
+             const char *format, const string& owner)
+    {
+        Resource resource;
+        resource.bytes = bytes;
+        resource.format = format;
+        resource.owner = owner.empty() ? GetOwner() : owner;
+
+        lock_guard<mutex> lock(ResourcesMutex);
+        size_t before = 0;
+        map<ResourceKey, Resource>::iterator it = Resources.find(ResourceKey(category, handle));
+        if (it != Resources.end()) {
+            before = it->second.bytes;
+            it->second = resource;
+        }
+        else {
+            Resources[ResourceKey(category, handle)] = resource;
+            Counts[category]++;
+        }
+
+        Bytes[category] = Bytes[category] - before + bytes;
+        if (!IsOnGPU(category))
+            return;
+
+        size_t previous = GPUBytes;
+        GPUBytes = GPUBytes - before + bytes;
+        PeakGPUBytes = max(PeakGPUBytes, GPUBytes);
+
+        // Only the allocation that crosses the budget is reported
+        if (Budget && GPUBytes > Budget && previous <= Budget) {
+            cerr << "Warning: GPU memory is at " << GPUBytes / Megabyte << " MB, over the "
+                 << Budget / Megabyte << " MB budget, after " << resource.owner << "'s "
+                 << bytes / Megabyte << " MB " << format << " " << CategoryNames[category] << endl;
+        }
+    }
+
+    void Remove(ResourceCategory category, uintptr_t handle)
+    {
+        lock_guard<mutex> lock(ResourcesMutex);
+        map<ResourceKey, Resource>::iterator it = Resources.find(ResourceKey(category, handle));
+        if (it == Resources.end())
+            return;
+        Bytes[category] -= it->second.bytes;
+        Counts[category]--;
+        if (IsOnGPU(category))
+            GPUBytes -= it->second.bytes;
+        Resources.erase(it);
+    }
+
+    size_t GetBytes(ResourceCategory category)
+    {
+        lock_guard<mutex> lock(ResourcesMutex);
+        return Bytes[category];
+    }
+
+    int GetCount(ResourceCategory category)
+    {
+        lock_guard<mutex> lock(ResourcesMutex);
+        return Counts[category];
+    }
+
+    size_t GetGPUBytes()
+    {
+        lock_guard<mutex> lock(ResourcesMutex);
+        return GPUBytes;
+    }
+
+    size_t GetPeakGPUBytes()
+    {
+        lock_guard<mutex> lock(ResourcesMutex);
+        return PeakGPUBytes;
+    }
+
+    void SetBudget(size_t bytes)
+    {
+        lock_guard<mutex> lock(ResourcesMutex);
+        Budget = bytes;
+    }
+
+    string GetOwner()
+    {
+        return Owner ? Owner->name : "unowned";
+    }
+
+    void Report(ostream& out)
+    {
+        lock_guard<mutex> lock(ResourcesMutex);
+        out << "Memory:" << endl;
+        for (int i = 0; i < RESOURCE_CATEGORIES; i++) {
+            out << "  " << CategoryNames[i] << ": " << Counts[i] << ", "
+                << Bytes[i] / Megabyte << " MB" << endl;
+        }
+        out << "  GPU total " << GPUBytes / Megabyte << " MB, peak " << PeakGPUBytes / Megabyte << " MB";
+        if (Budget)
+            out << ", budget " << Budget / Megabyte << " MB";
+        out << endl;
+    }
+
+    int ReportLeaks(ostream& out)
+    {
+        lock_guard<mutex> lock(ResourcesMutex);
+        if (Resources.empty())
+            return 0;
+
+        // Sorted by owner, so each one's leaks are together
+        vector<pair<string, ResourceKey> > leaks;
+        for (map<ResourceKey, Resource>::iterator it = Resources.begin(); it != Resources.end(); ++it) {
+            leaks.push_back(make_pair(it->second.owner, it->first));
+        }
+        sort(leaks.begin(), leaks.end());
+
+        out << "Warning: " << leaks.size() << " resources were never freed:" << endl;
+        for (size_t i = 0; i < leaks.size(); i++) {
+            const Resource& resource = Resources[leaks[i].second];
+            out << "  " << resource.owner << ": " << CategoryNames[leaks[i].second.first]
+                << " #" << leaks[i].second.second << ", " << resource.format << ", "
+                << resource.bytes / Megabyte << " MB" << endl;
+        }
+        return (int) leaks.size();
+    }
+}
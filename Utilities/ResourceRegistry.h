@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <stdint.h>
+#include <string>
+
+/** Kinds of memory the registry totals separately. Framebuffers own no
+    memory of their own (their attachments do) but are counted, so ones
+    that are never deleted still show up. */
+enum ResourceCategory
+{
+    RESOURCE_TEXTURE,
+    RESOURCE_RENDER_TARGET,
+    RESOURCE_BUFFER,
+    RESOURCE_RENDERBUFFER,
+    RESOURCE_FRAMEBUFFER,
+    RESOURCE_IMAGE,
+    RESOURCE_CATEGORIES
+};
+
+/** Accounting of the memory held by textures, buffers, framebuffers
+    and the bitmaps kept after upload. Each allocation is recorded with
+    its size, format and owner when it is made, and dropped when it is
+    freed, so totals can be reported at any time and whatever is still
+    held at shutdown reported as leaked.
+
+    Everything but images is on the GPU. With a budget set, a warning
+    is printed whenever an allocation takes the GPU total over it.
+    The functions may be called from any thread. */
+namespace ResourceRegistry
+{
+    /** Records an allocation, identified by its category and handle
+        (the OpenGL name, or the address for images and for framebuffers,
+        whose names each context counts on its own). Recording the
+        same one again replaces it, for storage that is reallocated.
+        Without an owner, the innermost ResourceOwner's name is used.
+        The format must be a string literal. */
+    void Add(ResourceCategory category, uintptr_t handle, size_t bytes,
+             const char *format, const std::string& owner = "");
+
+    /** Forgets an allocation; unknown ones are ignored */
+    void Remove(ResourceCategory category, uintptr_t handle);
+
+    /** Returns the bytes and number of allocations held in a category */
+    size_t GetBytes(ResourceCategory category);
+    int GetCount(ResourceCategory category);
+
+    /** Returns the bytes held on the GPU now, and at most so far */
+    size_t GetGPUBytes();
+    size_t GetPeakGPUBytes();
+
+    /** Sets the GPU memory allowed before warning, 0 for none */
+    void SetBudget(size_t bytes);
+
+    /** Returns the name of the calling thread's innermost owner scope */
+    std::string GetOwner();
+
+    /** Prints the totals by category */
+    void Report(std::ostream& out = std::cout);
+
+    /** Prints every allocation still held, by owner, and returns how
+        many there are. Meant for after everything has been freed. */
+    int ReportLeaks(std::ostream& out = std::cerr);
+}
+
+/** Names the owner of the allocations made on this thread while it
+    exists, for the ones that don't name their own */
+class ResourceOwner
+{
+public:
+    ResourceOwner(const char *name);
+    ~ResourceOwner();
+
+private:
+    const char *name;
+    const ResourceOwner *outer;
+
+    friend std::string ResourceRegistry::GetOwner();
+};
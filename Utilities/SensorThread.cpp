@@ -0,0 +1,77 @@
+#include "SensorThread.h"
+
+#include <cmath>
+
+using namespace std;
+using namespace glm;
+
+SensorThread::SensorThread(HMD *hmd)
+: hmd(hmd), start(chrono::steady_clock::now()), running(true)
+{
+    // The first pose is there before anyone reads
+    Pose pose;
+    pose.time = Now();
+    pose.orientation = hmd->GetOrientation();
+    pose.angularVelocity = vec3(0);
+    latest.Write(pose);
+    
+    thread = std::thread(&SensorThread::Run, this);
+}
+
+SensorThread::~SensorThread()
+{
+    running = false;
+    thread.join();
+}
+
+double SensorThread::Now() const
+{
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+void SensorThread::Run()
+{
+    Pose previous = latest.Read();
+    chrono::steady_clock::time_point next = chrono::steady_clock::now();
+    chrono::duration<double> period(1.0 / SENSOR_RATE);
+    
+    while (running) {
+        next += chrono::duration_cast<chrono::steady_clock::duration>(period);
+        this_thread::sleep_until(next);
+        
+        Pose pose;
+        pose.orientation = hmd->GetOrientation();
+        pose.time = Now() - hmd->GetSampleAge() / 1000.0;
+        
+        // Turn since the last sample, as an angle about a world axis
+        pose.angularVelocity = previous.angularVelocity;
+        double dt = pose.time - previous.time;
+        if (dt > 0) {
+            quat turn = pose.orientation * conjugate(previous.orientation);
+            if (turn.w < 0)
+                turn = quat(-turn.w, -turn.x, -turn.y, -turn.z);
+            float sine = length(vec3(turn.x, turn.y, turn.z));
+            float angle = 2.0f * atan2(sine, turn.w);
+            pose.angularVelocity = (sine > 0) ? vec3(turn.x, turn.y, turn.z) * (float) (angle / sine / dt)
+                                              : vec3(0);
+        }
+        
+        latest.Write(pose);
+        previous = pose;
+    }
+}
+
+quat SensorThread::Predict(const Pose& pose, double time)
+{
+    float speed = length(pose.angularVelocity);
+    if (speed <= 0)
+        return pose.orientation;
+    
+    // Built by hand, as angleAxis takes degrees or radians depending
+    // on the GLM version
+    float angle = speed * (float) (time - pose.time);
+    vec3 axis = pose.angularVelocity * (sin(angle / 2) / speed);
+    quat turn(cos(angle / 2), axis.x, axis.y, axis.z);
+    return normalize(turn * pose.orientation);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "HMD.h"
+#include "Seqlock.hpp"
+
+/* Rate the sensor is read and fused at, in Hz */
+#define SENSOR_RATE 1000
+
+/** A head orientation at a point in time (seconds on the sensor
+    thread's clock), with the rate it was turning at (radians per
+    second, about a world axis) */
+struct Pose
+{
+    double time;
+    glm::quat orientation;
+    glm::vec3 angularVelocity;
+};
+
+/** Reads the HMD's sensor on its own thread at SENSOR_RATE, and
+    publishes timestamped poses through a seqlock.
+
+    The render loop and the late latch read the newest pose without
+    locks, in a few nanoseconds, and can extrapolate it to the time
+    the frame will be seen. Only this thread calls the HMD's
+    GetOrientation once started. */
+class SensorThread
+{
+public:
+    SensorThread(HMD *hmd);
+    ~SensorThread();
+    
+    /** Returns the newest pose */
+    Pose GetPose() const { return latest.Read(); }
+    
+    /** Returns the orientation extrapolated from a pose to a time, at
+        the rate it was turning */
+    static glm::quat Predict(const Pose& pose, double time);
+    
+    /** Returns the time on the clock poses are stamped with */
+    double Now() const;
+    
+    /** Returns the number of poses published */
+    unsigned GetPoseCount() const { return latest.GetVersion(); }
+    
+private:
+    void Run();
+    
+    HMD *hmd;
+    std::chrono::steady_clock::time_point start;
+    Seqlock<Pose> latest;
+    std::atomic<bool> running;
+    std::thread thread;
+};
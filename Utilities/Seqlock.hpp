@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <stdint.h>
+
+/** Publishes a small value from one writer thread to any number of
+    readers, without locks.
+
+    The writer never waits. Readers copy the value and retry only if
+    the writer was in the middle of an update; with updates far apart
+    compared to a copy (a sensor at 1 kHz, a copy of tens of bytes)
+    a read almost always takes one pass. The value is kept as atomic
+    words, so T must be trivially copyable. */
+template <typename T>
+class Seqlock
+{
+public:
+    Seqlock() : sequence(0)
+    {
+        Write(T());
+    }
+    
+    /** Writer: replaces the value */
+    void Write(const T& value)
+    {
+        uint32_t buffer[WORDS] = { 0 };
+        memcpy(buffer, &value, sizeof(T));
+        
+        // An odd sequence marks an update in progress
+        unsigned start = sequence.load(std::memory_order_relaxed);
+        sequence.store(start + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (int i = 0; i < WORDS; i++)
+            words[i].store(buffer[i], std::memory_order_relaxed);
+        sequence.store(start + 2, std::memory_order_release);
+    }
+    
+    /** Reader: returns the latest complete value */
+    T Read() const
+    {
+        uint32_t buffer[WORDS];
+        unsigned before, after;
+        do {
+            before = sequence.load(std::memory_order_acquire);
+            for (int i = 0; i < WORDS; i++)
+                buffer[i] = words[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+        
+        T value;
+        memcpy(&value, buffer, sizeof(T));
+        return value;
+    }
+    
+    /** Returns the number of values written so far */
+    unsigned GetVersion() const
+    {
+        return sequence.load(std::memory_order_acquire) / 2 - 1;
+    }
+    
+private:
+    enum { WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t) };
+    
+    std::atomic<unsigned> sequence;
+    std::atomic<uint32_t> words[WORDS];
+};
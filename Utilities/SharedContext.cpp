@@ -0,0 +1,132 @@
+#include "SharedContext.h"
+
+#ifdef __APPLE__
+#include <OpenGL/OpenGL.h>
+#else
+#include <GL/glx.h>
+#endif
+
+#include <iostream>
+
+using namespace std;
+
+#ifdef __APPLE__
+
+struct SharedContext::Handles
+{
+    CGLContextObj context;
+};
+
+void SharedContext::InitThreads()
+{
+}
+
+SharedContext::SharedContext()
+: handles(new Handles())
+{
+    handles->context = NULL;
+    
+    CGLContextObj share = CGLGetCurrentContext();
+    if (!share) {
+        cerr << "Warning: no current context to share with" << endl;
+        return;
+    }
+    if (CGLCreateContext(CGLGetPixelFormat(share), share, &handles->context) != kCGLNoError) {
+        cerr << "Warning: unable to create a shared context" << endl;
+        handles->context = NULL;
+    }
+}
+
+SharedContext::~SharedContext()
+{
+    if (handles->context)
+        CGLDestroyContext(handles->context);
+    delete handles;
+}
+
+bool SharedContext::IsValid() const
+{
+    return handles->context != NULL;
+}
+
+bool SharedContext::MakeCurrent()
+{
+    return handles->context && CGLSetCurrentContext(handles->context) == kCGLNoError;
+}
+
+void SharedContext::Release()
+{
+    CGLSetCurrentContext(NULL);
+}
+
+#else
+
+struct SharedContext::Handles
+{
+    Display *display;
+    GLXDrawable drawable;
+    GLXContext context;
+};
+
+void SharedContext::InitThreads()
+{
+    // Xlib is only safe to call from several threads when asked first
+    XInitThreads();
+}
+
+SharedContext::SharedContext()
+: handles(new Handles())
+{
+    handles->display = glXGetCurrentDisplay();
+    handles->drawable = glXGetCurrentDrawable();
+    handles->context = NULL;
+    
+    GLXContext share = glXGetCurrentContext();
+    if (!share) {
+        cerr << "Warning: no current context to share with" << endl;
+        return;
+    }
+    
+    // Same framebuffer configuration as the window's context
+    int configID = 0, screen = 0, count = 0;
+    glXQueryContext(handles->display, share, GLX_FBCONFIG_ID, &configID);
+    glXQueryContext(handles->display, share, GLX_SCREEN, &screen);
+    int attributes[] = { GLX_FBCONFIG_ID, configID, None };
+    GLXFBConfig *configs = glXChooseFBConfig(handles->display, screen, attributes, &count);
+    if (!configs || count == 0) {
+        cerr << "Warning: unable to find the window's framebuffer configuration" << endl;
+        return;
+    }
+    
+    handles->context = glXCreateNewContext(handles->display, configs[0], GLX_RGBA_TYPE, share, True);
+    XFree(configs);
+    if (!handles->context) {
+        cerr << "Warning: unable to create a shared context" << endl;
+    }
+}
+
+SharedContext::~SharedContext()
+{
+    if (handles->context)
+        glXDestroyContext(handles->display, handles->context);
+    delete handles;
+}
+
+bool SharedContext::IsValid() const
+{
+    return handles->context != NULL;
+}
+
+bool SharedContext::MakeCurrent()
+{
+    // Bound to the window, but only ever draws into framebuffer objects
+    return handles->context && glXMakeContextCurrent(handles->display, handles->drawable,
+                                                     handles->drawable, handles->context);
+}
+
+void SharedContext::Release()
+{
+    glXMakeContextCurrent(handles->display, None, None, NULL);
+}
+
+#endif
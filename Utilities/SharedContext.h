@@ -0,0 +1,37 @@
+#pragma once
+
+/** A second OpenGL context sharing textures, buffers and programs
+    with the one GLUT created, so another thread can render into
+    textures the window's thread then reads.
+
+    The new context draws only into framebuffer objects; it has no
+    window of its own. Container objects (framebuffer objects) are
+    not shared and must be created by the thread using them.
+    
+    The window system's types stay in the .cpp, as Xlib's clash with
+    names used elsewhere (Screen). */
+class SharedContext
+{
+public:
+    /** Must be called before glutInit when contexts will be used
+        from several threads */
+    static void InitThreads();
+    
+    /** Creates a context sharing with the one current on the calling
+        thread */
+    SharedContext();
+    ~SharedContext();
+    
+    /** Returns whether the context was created */
+    bool IsValid() const;
+    
+    /** Makes the context current on the calling thread */
+    bool MakeCurrent();
+    
+    /** Detaches the context from the calling thread */
+    void Release();
+    
+private:
+    struct Handles;
+    Handles *handles;
+};
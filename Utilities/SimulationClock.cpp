@@ -0,0 +1,27 @@
+#include "SimulationClock.h"
+
+SimulationClock::SimulationClock(double timestep, int maxSteps)
+: timestep(timestep), maxSteps(maxSteps), accumulator(0), steps(0), dropped(0)
+{
+}
+
+int SimulationClock::Advance()
+{
+    return Advance(timer.Lap() / 1000.0);
+}
+
+int SimulationClock::Advance(double elapsed)
+{
+    accumulator += elapsed;
+    
+    int due = (int) (accumulator / timestep);
+    accumulator -= due * timestep;
+    
+    if (due > maxSteps) {
+        dropped += due - maxSteps;
+        due = maxSteps;
+    }
+    
+    steps += due;
+    return due;
+}
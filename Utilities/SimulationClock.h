@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Timer.h"
+
+/** Fixed timestep clock, to run the simulation at its own rate no
+    matter how fast frames are drawn.
+
+    Each frame, Advance says how many fixed steps of simulation are due
+    for the real time that has passed. After a stall it catches up, but
+    never more than maxSteps at once; the rest of the backlog is
+    dropped so a slow frame cannot snowball. GetAlpha says how far
+    between the last two simulation states the present moment lies,
+    for interpolating what is drawn. */
+class SimulationClock
+{
+public:
+    /** timestep is in seconds */
+    SimulationClock(double timestep, int maxSteps);
+    
+    /** Adds the real time since the last call, and returns the
+        number of steps to simulate */
+    int Advance();
+    
+    /** Same, with the elapsed time (in seconds) given explicitly */
+    int Advance(double elapsed);
+    
+    /** Returns the length of a step, in seconds */
+    double GetTimestep() const { return timestep; }
+    
+    /** Returns the fraction (0 to 1) of a step that has passed
+        since the last simulated state */
+    float GetAlpha() const { return (float) (accumulator / timestep); }
+    
+    /** Returns the simulated time so far, in seconds */
+    double GetTime() const { return steps * timestep; }
+    
+    /** Returns the number of steps that were due but dropped */
+    long GetDroppedSteps() const { return dropped; }
+    
+private:
+    double timestep;
+    int maxSteps;
+    double accumulator;
+    long steps;
+    long dropped;
+    Timer timer;
+};
@@ -0,0 +1,255 @@
+#include "SplinePath.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#endif
+
+using namespace std;
+using namespace glm;
+
+SplinePath::SplinePath(const vector<vec3>& points)
+: segmentCount(0), tableStep(1.0f), length(0.0f)
+{
+    // Catmull-Rom basis (see CMSpline.hpp), expanded per axis
+    for (size_t i = 0; i + 3 < points.size(); i++) {
+        const vec3& p0 = points[i];
+        const vec3& p1 = points[i + 1];
+        const vec3& p2 = points[i + 2];
+        const vec3& p3 = points[i + 3];
+        for (int axis = 0; axis < 3; axis++) {
+            coefficients.push_back(p1[axis]);
+            coefficients.push_back(0.5f * (p2[axis] - p0[axis]));
+            coefficients.push_back(p0[axis] - 2.5f * p1[axis] + 2.0f * p2[axis] - 0.5f * p3[axis]);
+            coefficients.push_back(-0.5f * p0[axis] + 1.5f * p1[axis] - 1.5f * p2[axis] + 0.5f * p3[axis]);
+        }
+        coefficients.resize(coefficients.size() + PATH_SEGMENT_STRIDE - 12, 0.0f);
+        segmentCount++;
+    }
+
+    TableEntry start = { 0, 0.0f };
+    if (segmentCount == 0) {
+        table.assign(2, start);
+        return;
+    }
+
+    // Approximate arc length with chords between evenly spaced samples
+    vector<float> lengths(1, 0.0f);
+    vector<TableEntry> samples(1, start);
+    vec3 previous = GetPositionAt(0, 0.0f);
+    for (size_t segment = 0; segment < segmentCount; segment++) {
+        for (int sample = 1; sample <= PATH_SAMPLES_PER_SEGMENT; sample++) {
+            TableEntry entry = { (int) segment, sample / (float) PATH_SAMPLES_PER_SEGMENT };
+            vec3 point = GetPositionAt(entry.segment, entry.u);
+            lengths.push_back(lengths.back() + glm::length(point - previous));
+            samples.push_back(entry);
+            previous = point;
+        }
+    }
+    length = lengths.back();
+
+    // Resample to even distance steps, so lookups need no search
+    size_t entries = lengths.size();
+    tableStep = length / (entries - 1);
+    size_t sample = 0;
+    for (size_t i = 0; i < entries; i++) {
+        float distance = std::min(i * tableStep, length);
+        while (sample + 2 < entries && lengths[sample + 1] < distance)
+            sample++;
+
+        float span = lengths[sample + 1] - lengths[sample];
+        float t = (span > 0.0f) ? (distance - lengths[sample]) / span : 0.0f;
+
+        // The interval may start at the end of the previous segment
+        TableEntry entry = samples[sample + 1];
+        float from = (samples[sample].segment == entry.segment) ? samples[sample].u : 0.0f;
+        entry.u = from + (entry.u - from) * t;
+        table.push_back(entry);
+    }
+}
+
+vec3 SplinePath::GetPositionAt(int segment, float u) const
+{
+    const float *c = &coefficients[segment * PATH_SEGMENT_STRIDE];
+    vec3 point;
+    for (int axis = 0; axis < 3; axis++, c += 4) {
+        point[axis] = ((c[3] * u + c[2]) * u + c[1]) * u + c[0];
+    }
+    return point;
+}
+
+vec3 SplinePath::GetTangentAt(int segment, float u) const
+{
+    const float *c = &coefficients[segment * PATH_SEGMENT_STRIDE];
+    vec3 tangent;
+    for (int axis = 0; axis < 3; axis++, c += 4) {
+        tangent[axis] = (3.0f * c[3] * u + 2.0f * c[2]) * u + c[1];
+    }
+    return normalize(tangent);
+}
+
+void SplinePath::Locate(float distance, int& segment, float& u) const
+{
+    float position = std::min(std::max(distance, 0.0f), length) * (1.0f / tableStep);
+    size_t entry = std::min((size_t) position, table.size() - 2);
+    float t = position - entry;
+
+    // Neighbouring entries are at most one segment apart; measure
+    // the next one's parameter from the start of this segment
+    const TableEntry& here = table[entry];
+    const TableEntry& next = table[entry + 1];
+    segment = here.segment;
+    u = here.u + (next.u + (next.segment - here.segment) - here.u) * t;
+    if (u >= 1.0f && segment + 1 < (int) segmentCount) {
+        segment++;
+        u -= 1.0f;
+    }
+}
+
+vec3 SplinePath::GetPosition(float distance) const
+{
+    if (segmentCount == 0)
+        return vec3(0);
+    int segment;
+    float u;
+    Locate(distance, segment, u);
+    return GetPositionAt(segment, u);
+}
+
+vec3 SplinePath::GetDirection(float distance) const
+{
+    if (segmentCount == 0)
+        return vec3(0, 1, 0);
+    int segment;
+    float u;
+    Locate(distance, segment, u);
+    return GetTangentAt(segment, u);
+}
+
+void SplinePath::Evaluate4(const float *distances, bool derivative,
+                           float *x, float *y, float *z) const
+{
+    float *out[3] = { x, y, z };
+
+#ifdef __SSE2__
+    // Table positions for all four lanes
+    __m128 position = _mm_loadu_ps(distances);
+    position = _mm_min_ps(_mm_max_ps(position, _mm_setzero_ps()), _mm_set1_ps(length));
+    position = _mm_mul_ps(position, _mm_set1_ps(1.0f / tableStep));
+    __m128i entry = _mm_cvttps_epi32(_mm_min_ps(position, _mm_set1_ps((float) (table.size() - 2))));
+    __m128 t = _mm_sub_ps(position, _mm_cvtepi32_ps(entry));
+
+    int entries[4];
+    _mm_storeu_si128((__m128i *) entries, entry);
+
+    // Table lookups are gathers, one lane at a time
+    int segments[4];
+    float starts[4], ends[4];
+    for (int lane = 0; lane < 4; lane++) {
+        const TableEntry& here = table[entries[lane]];
+        const TableEntry& next = table[entries[lane] + 1];
+        segments[lane] = here.segment;
+        starts[lane] = here.u;
+        ends[lane] = next.u + (next.segment - here.segment);
+    }
+    __m128 start = _mm_loadu_ps(starts);
+    float us[4];
+    _mm_storeu_ps(us, _mm_add_ps(start, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(ends), start), t)));
+    for (int lane = 0; lane < 4; lane++) {
+        if (us[lane] >= 1.0f && segments[lane] + 1 < (int) segmentCount) {
+            segments[lane]++;
+            us[lane] -= 1.0f;
+        }
+    }
+    __m128 u = _mm_loadu_ps(us);
+
+    // Each segment's coefficients are four rows of four (x, y, z,
+    // padding); transposing four segments gives one register per power
+    const float *c[4];
+    for (int lane = 0; lane < 4; lane++)
+        c[lane] = &coefficients[segments[lane] * PATH_SEGMENT_STRIDE];
+
+    __m128 values[3];
+    for (int axis = 0; axis < 3; axis++) {
+        __m128 c0 = _mm_loadu_ps(c[0] + 4 * axis);
+        __m128 c1 = _mm_loadu_ps(c[1] + 4 * axis);
+        __m128 c2 = _mm_loadu_ps(c[2] + 4 * axis);
+        __m128 c3 = _mm_loadu_ps(c[3] + 4 * axis);
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+        // Horner's rule for the cubic or its derivative
+        if (derivative) {
+            __m128 value = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(_mm_set1_ps(3.0f), c3), u),
+                                      _mm_mul_ps(_mm_set1_ps(2.0f), c2));
+            values[axis] = _mm_add_ps(_mm_mul_ps(value, u), c1);
+        }
+        else {
+            __m128 value = _mm_add_ps(_mm_mul_ps(c3, u), c2);
+            value = _mm_add_ps(_mm_mul_ps(value, u), c1);
+            values[axis] = _mm_add_ps(_mm_mul_ps(value, u), c0);
+        }
+    }
+
+    if (derivative) {
+        __m128 squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(values[0], values[0]),
+                                               _mm_mul_ps(values[1], values[1])),
+                                    _mm_mul_ps(values[2], values[2]));
+        __m128 inverse = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(squared));
+        for (int axis = 0; axis < 3; axis++)
+            values[axis] = _mm_mul_ps(values[axis], inverse);
+    }
+
+    for (int axis = 0; axis < 3; axis++)
+        _mm_storeu_ps(out[axis], values[axis]);
+#else
+    for (int lane = 0; lane < 4; lane++) {
+        vec3 value = derivative ? GetDirection(distances[lane]) : GetPosition(distances[lane]);
+        for (int axis = 0; axis < 3; axis++)
+            out[axis][lane] = value[axis];
+    }
+#endif
+}
+
+/** Runs Evaluate4 over a batch, padding the last group of four */
+void SplinePath::EvaluateBatch(const float *distances, bool derivative,
+                               float *x, float *y, float *z, size_t count) const
+{
+    if (segmentCount == 0) {
+        for (size_t i = 0; i < count; i++) {
+            x[i] = 0.0f;
+            y[i] = derivative ? 1.0f : 0.0f;
+            z[i] = 0.0f;
+        }
+        return;
+    }
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        Evaluate4(distances + i, derivative, x + i, y + i, z + i);
+    }
+    if (i < count) {
+        float padded[4];
+        float tail[3][4];
+        for (size_t lane = 0; lane < 4; lane++)
+            padded[lane] = distances[std::min(i + lane, count - 1)];
+        Evaluate4(padded, derivative, tail[0], tail[1], tail[2]);
+        for (size_t lane = 0; i + lane < count; lane++) {
+            x[i + lane] = tail[0][lane];
+            y[i + lane] = tail[1][lane];
+            z[i + lane] = tail[2][lane];
+        }
+    }
+}
+
+void SplinePath::GetPositions(const float *distances, float *x, float *y, float *z, size_t count) const
+{
+    EvaluateBatch(distances, false, x, y, z, count);
+}
+
+void SplinePath::GetDirections(const float *distances, float *x, float *y, float *z, size_t count) const
+{
+    EvaluateBatch(distances, true, x, y, z, count);
+}
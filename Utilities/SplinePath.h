@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+/* Arc length samples per spline segment */
+#define PATH_SAMPLES_PER_SEGMENT 64
+
+/* Floats of coefficients per segment (3 axes x 4 powers, padded) */
+#define PATH_SEGMENT_STRIDE 16
+
+/** A Catmull-Rom path through a chain of points, parameterized by
+    distance along the path, so that moving a fixed distance per frame
+    gives a constant speed. The first and last points only shape the
+    ends: the path runs from the second point to the second to last.
+
+    The arc length table is resampled to even distance steps, so
+    finding a point is a table lookup plus a cubic. The batched calls
+    take and return structure-of-arrays data and evaluate four
+    distances at a time with SSE2, for paths sampled thousands of
+    times a frame (camera paths, rover traverses, track geometry). */
+class SplinePath
+{
+public:
+    /** Needs at least four points */
+    SplinePath(const std::vector<glm::vec3>& points);
+
+    /** Returns the length of the path */
+    float GetLength() const { return length; }
+
+    /** Returns the number of cubic segments */
+    size_t GetSegmentCount() const { return segmentCount; }
+
+    /** Returns the point the given distance along the path
+        (clamped to the path's ends) */
+    glm::vec3 GetPosition(float distance) const;
+
+    /** Returns the unit direction of travel at the given distance */
+    glm::vec3 GetDirection(float distance) const;
+
+    /** Batched GetPosition and GetDirection, writing count results
+        into separate x, y and z arrays */
+    void GetPositions(const float *distances, float *x, float *y, float *z, size_t count) const;
+    void GetDirections(const float *distances, float *x, float *y, float *z, size_t count) const;
+
+private:
+    /** Evaluates one segment's cubic, or its normalized derivative */
+    glm::vec3 GetPositionAt(int segment, float u) const;
+    glm::vec3 GetTangentAt(int segment, float u) const;
+
+    /** Finds the segment and spline parameter at a distance */
+    void Locate(float distance, int& segment, float& u) const;
+
+    /** Locates and evaluates four distances at once. derivative
+        selects the (normalized) tangent instead of the position. */
+    void Evaluate4(const float *distances, bool derivative,
+                   float *x, float *y, float *z) const;
+
+    void EvaluateBatch(const float *distances, bool derivative,
+                       float *x, float *y, float *z, size_t count) const;
+
+    /** Cubic coefficients, PATH_SEGMENT_STRIDE floats per segment: for
+        each axis c0..c3 with p(u) = c0 + c1 u + c2 u^2 + c3 u^3. A
+        segment's coefficients share a cache line, and four segments'
+        rows transpose into one SIMD register per power. */
+    std::vector<float> coefficients;
+    size_t segmentCount;
+
+    /** Segment and parameter at evenly spaced distances along the
+        path, tableStep apart */
+    struct TableEntry
+    {
+        int segment;
+        float u;
+    };
+    std::vector<TableEntry> table;
+    float tableStep;
+    float length;
+};
@@ -0,0 +1,151 @@
+#include "SyntheticHMD.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+using namespace glm;
+
+SyntheticHMD::SyntheticHMD()
+: sampleAge(0), start(chrono::steady_clock::now())
+{
+    // Rift DK1
+    resolution[0] = 1280;
+    resolution[1] = 800;
+    screenSize[0] = 0.14976f;
+    screenSize[1] = 0.0936f;
+    screenCenter = 0.0468f;
+    eyeToScreenDistance = 0.041f;
+    lensSeparationDistance = 0.0635f;
+    interpupillaryDistance = 0.064f;
+    
+    float K[4] = { 1.0f, 0.22f, 0.24f, 0.0f };
+    float chroma[4] = { 0.996f, -0.004f, 1.014f, 0.0f };
+    memcpy(distortionK, K, sizeof(K));
+    memcpy(chromaAbCorrection, chroma, sizeof(chroma));
+    
+    Motion yaw = { 2, radians(30.0f), 0.5f };
+    Motion pitch = { 0, radians(10.0f), 0.3f };
+    motions.push_back(yaw);
+    motions.push_back(pitch);
+    scripted[0] = scripted[1] = scripted[2] = false;
+}
+
+bool SyntheticHMD::Load(const string& path)
+{
+    ifstream file(path.c_str());
+    if (!file) {
+        cerr << "Warning: unable to open HMD configuration " << path << endl;
+        return false;
+    }
+    
+    string line;
+    while (getline(file, line)) {
+        istringstream fields(line.substr(0, line.find('#')));
+        string key;
+        if (!(fields >> key))
+            continue;
+        
+        if (!Configure(key, fields))
+            cerr << "Warning: unknown HMD setting " << key << " in " << path << endl;
+        else if (fields.fail())
+            cerr << "Warning: bad value for " << key << " in " << path << endl;
+    }
+    return true;
+}
+
+bool SyntheticHMD::Configure(const string& key, istream& values)
+{
+    if (key == "HResolution")
+        values >> resolution[0];
+    else if (key == "VResolution")
+        values >> resolution[1];
+    else if (key == "HScreenSize")
+        values >> screenSize[0];
+    else if (key == "VScreenSize")
+        values >> screenSize[1];
+    else if (key == "VScreenCenter")
+        values >> screenCenter;
+    else if (key == "EyeToScreenDistance")
+        values >> eyeToScreenDistance;
+    else if (key == "LensSeparationDistance")
+        values >> lensSeparationDistance;
+    else if (key == "InterpupillaryDistance")
+        values >> interpupillaryDistance;
+    else if (key == "DistortionK")
+        values >> distortionK[0] >> distortionK[1] >> distortionK[2] >> distortionK[3];
+    else if (key == "ChromaAbCorrection")
+        values >> chromaAbCorrection[0] >> chromaAbCorrection[1]
+               >> chromaAbCorrection[2] >> chromaAbCorrection[3];
+    else if (key == "pitch" || key == "roll" || key == "yaw") {
+        Motion motion;
+        motion.axis = (key == "pitch") ? 0 : (key == "roll") ? 1 : 2;
+        values >> motion.amplitude >> motion.frequency;
+        motion.amplitude = radians(motion.amplitude);
+        
+        // The first line for an axis replaces its default motion
+        if (!scripted[motion.axis]) {
+            for (size_t i = 0; i < motions.size(); ) {
+                if (motions[i].axis == motion.axis)
+                    motions.erase(motions.begin() + i);
+                else
+                    i++;
+            }
+            scripted[motion.axis] = true;
+        }
+        motions.push_back(motion);
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+double SyntheticHMD::GetTime() const
+{
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+bool SyntheticHMD::GetInfo(OVR::HMDInfo& info)
+{
+    strncpy(info.ProductName, "Synthetic HMD", OVR::DeviceInfo::MaxNameLength);
+    strncpy(info.Manufacturer, "A Walk on Mars", OVR::DeviceInfo::MaxNameLength);
+    strncpy(info.DisplayDeviceName, "", sizeof(info.DisplayDeviceName));
+    info.Version = 1;
+    info.HResolution = resolution[0];
+    info.VResolution = resolution[1];
+    info.HScreenSize = screenSize[0];
+    info.VScreenSize = screenSize[1];
+    info.VScreenCenter = screenCenter;
+    info.EyeToScreenDistance = eyeToScreenDistance;
+    info.LensSeparationDistance = lensSeparationDistance;
+    info.InterpupillaryDistance = interpupillaryDistance;
+    for (int i = 0; i < 4; i++) {
+        info.DistortionK[i] = distortionK[i];
+        info.ChromaAbCorrection[i] = chromaAbCorrection[i];
+    }
+    return true;
+}
+
+quat SyntheticHMD::GetOrientation()
+{
+    // Hold each sample until the next one is due
+    double now = GetTime();
+    double sample = floor(now * SYNTHETIC_SENSOR_RATE) / SYNTHETIC_SENSOR_RATE;
+    sampleAge = (now - sample) * 1000.0;
+    return GetOrientationAt(sample);
+}
+
+quat SyntheticHMD::GetOrientationAt(double seconds) const
+{
+    vec3 angles(0);
+    for (size_t i = 0; i < motions.size(); i++) {
+        const Motion& motion = motions[i];
+        angles[motion.axis] += motion.amplitude * (float) sin(2 * M_PI * motion.frequency * seconds);
+    }
+    return quat(angles);
+}
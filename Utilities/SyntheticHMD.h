@@ -0,0 +1,74 @@
+#pragma once
+
+#include <chrono>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "HMD.h"
+
+/* Rate the scripted sensor is sampled at, like the Rift's tracker */
+#define SYNTHETIC_SENSOR_RATE 1000
+
+/** A display that isn't there, with a head that moves by script.
+
+    The display defaults to the Rift DK1's optics, and the head sways
+    30 degrees at 0.5 Hz and nods 10 degrees at 0.3 Hz. Both can be
+    changed from a configuration file of "key value..." lines:
+
+        HResolution 1920
+        DistortionK 1.0 0.22 0.24 0.0
+        yaw 45 0.25         # degrees, Hz (one line per sine wave)
+        pitch 0 0           # clears the default nod
+
+    Any HMDInfo field can be set this way. The orientation is sampled
+    at SYNTHETIC_SENSOR_RATE, so it steps like a real sensor's. */
+class SyntheticHMD : public HMD
+{
+public:
+    SyntheticHMD();
+    
+    /** Reads a configuration file. Returns false if it can't be read. */
+    bool Load(const std::string& path);
+    
+    const char *GetName() const { return "synthetic"; }
+    bool GetInfo(OVR::HMDInfo& info);
+    bool HasSensor() const { return true; }
+    glm::quat GetOrientation();
+    double GetSampleAge() const { return sampleAge; }
+    
+    /** Returns the scripted orientation at a time (in seconds) */
+    glm::quat GetOrientationAt(double seconds) const;
+    
+protected:
+    /** Applies one configuration line's key and values. Returns false
+        if the key is unknown. */
+    bool Configure(const std::string& key, std::istream& values);
+    
+    /** Seconds since the HMD was created */
+    double GetTime() const;
+    
+private:
+    /** One sine wave of head motion about an axis (0 pitch, 1 roll, 2 yaw) */
+    struct Motion
+    {
+        int axis;
+        float amplitude;
+        float frequency;
+    };
+    
+    /* Display description */
+    unsigned resolution[2];
+    float screenSize[2];
+    float screenCenter;
+    float eyeToScreenDistance;
+    float lensSeparationDistance;
+    float interpupillaryDistance;
+    float distortionK[4];
+    float chromaAbCorrection[4];
+    
+    std::vector<Motion> motions;
+    bool scripted[3];
+    double sampleAge;
+    std::chrono::steady_clock::time_point start;
+};
@@ -0,0 +1,418 @@
+#include "TerrainStreamer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <unordered_set>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Random.h"
+#include "ResourceRegistry.h"
+#include "Trace.h"
+
+/* Heights come out around TERRAIN_BASE +- 2 * TERRAIN_RANGE */
+#define TERRAIN_BASE 0.65f
+#define TERRAIN_RANGE 0.05f
+
+using namespace std;
+using namespace glm;
+
+static inline uint64_t keyOf(int64_t x, int64_t y)
+{
+    return ((uint64_t) (uint32_t) x << 32) | (uint32_t) y;
+}
+
+static inline float smoothWeight(int64_t offset, int shift)
+{
+    float t = offset / (float) (1 << shift);
+    return t * t * (3.0f - 2.0f * t);
+}
+
+static inline float blend(float a, float b, float c, float d, float wx, float wy)
+{
+    float bottom = a + (b - a) * wx;
+    float top = c + (d - c) * wx;
+    return bottom + (top - bottom) * wy;
+}
+
+static double millisecondsSince(chrono::steady_clock::time_point start)
+{
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+TerrainStreamer::TerrainStreamer(uint32_t seed, vec3 start)
+: frame(0)
+{
+    for (int octave = 0; octave < TERRAIN_OCTAVES; octave++) {
+        octaveKeys[octave] = RandomKey(((uint64_t) seed << 8) | octave);
+    }
+
+    // Leave a core for the render thread
+    int threads = (int) thread::hardware_concurrency() - 1;
+    workers = new ThreadPool(threads > 0 ? threads : 1);
+
+    int size = TILE_RESOLUTION + 1;
+    glGenTextures(1, &textureArray);
+    glBindTexture(GL_TEXTURE_2D_ARRAY_EXT, textureArray);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY_EXT, 0, GL_R16, size, size, TILE_GPU_LAYERS,
+                 0, GL_RED, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY_EXT, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY_EXT, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY_EXT, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY_EXT, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D_ARRAY_EXT, 0);
+    ResourceRegistry::Add(RESOURCE_TEXTURE, textureArray,
+                          (size_t) size * size * TILE_GPU_LAYERS * 2, "R16 array", "Terrain tiles");
+
+    layerOwners.resize(TILE_GPU_LAYERS);
+    layerLastUsed.resize(TILE_GPU_LAYERS, -1);
+    for (int layer = TILE_GPU_LAYERS - 1; layer >= 0; layer--) {
+        freeLayers.push_back(layer);
+    }
+
+    // Build the first window up front, in parallel
+    centerX = (int) floorf(start.x / TILE_WORLD_SIZE);
+    centerY = (int) floorf(start.y / TILE_WORLD_SIZE);
+    vector<Tile *> tiles;
+    for (int y = -TILE_RING_RADIUS; y <= TILE_RING_RADIUS; y++) {
+        for (int x = -TILE_RING_RADIUS; x <= TILE_RING_RADIUS; x++) {
+            Tile *tile = new Tile();
+            tile->x = centerX + x;
+            tile->y = centerY + y;
+            tiles.push_back(tile);
+        }
+    }
+    workers->ParallelFor(tiles.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            Generate(*tiles[i]);
+    });
+    for (size_t i = 0; i < tiles.size(); i++) {
+        Insert(tiles[i]);
+        Upload(*tiles[i]);
+        stats.tilesGenerated++;
+    }
+    UpdateWindow();
+}
+
+TerrainStreamer::~TerrainStreamer()
+{
+    // Let outstanding generation finish before tearing anything down
+    delete workers;
+
+    for (size_t i = 0; i < finished.size(); i++) {
+        delete finished[i];
+    }
+    for (unordered_map<uint64_t, CacheEntry>::iterator it = cache.begin(); it != cache.end(); ++it) {
+        delete it->second.tile;
+    }
+    glDeleteTextures(1, &textureArray);
+    ResourceRegistry::Remove(RESOURCE_TEXTURE, textureArray);
+}
+
+float TerrainStreamer::SampleHeight(int64_t x, int64_t y) const
+{
+    float height = 0.0f;
+    float amplitude = 1.0f;
+    for (int octave = 0; octave < TERRAIN_OCTAVES; octave++) {
+        int shift = TERRAIN_OCTAVES - octave;
+        int64_t mask = ((int64_t) 1 << shift) - 1;
+        int64_t cx = x >> shift;
+        int64_t cy = y >> shift;
+        uint64_t key = octaveKeys[octave];
+
+        float a = RandomFloat(keyOf(cx, cy), key, -1.0f, 1.0f);
+        float b = RandomFloat(keyOf(cx + 1, cy), key, -1.0f, 1.0f);
+        float c = RandomFloat(keyOf(cx, cy + 1), key, -1.0f, 1.0f);
+        float d = RandomFloat(keyOf(cx + 1, cy + 1), key, -1.0f, 1.0f);
+        height += amplitude * blend(a, b, c, d, smoothWeight(x & mask, shift), smoothWeight(y & mask, shift));
+        amplitude /= 2.0f;
+    }
+    return TERRAIN_BASE + TERRAIN_RANGE * height;
+}
+
+void TerrainStreamer::Generate(Tile& tile) const
+{
+    TRACE_SCOPE("terrain", "Generate tile");
+    // Same sums as SampleHeight, but each octave's lattice values and
+    // weights are computed once per tile instead of once per sample
+    const int size = TILE_RESOLUTION + 1;
+    const int64_t x0 = (int64_t) tile.x * TILE_RESOLUTION;
+    const int64_t y0 = (int64_t) tile.y * TILE_RESOLUTION;
+
+    tile.heights.assign(size * size, 0.0f);
+    vector<float> lattice;
+    vector<float> weights(size);
+    vector<int> cells(size);
+
+    float amplitude = 1.0f;
+    for (int octave = 0; octave < TERRAIN_OCTAVES; octave++) {
+        int shift = TERRAIN_OCTAVES - octave;
+        int64_t mask = ((int64_t) 1 << shift) - 1;
+        int64_t lx = x0 >> shift;
+        int64_t ly = y0 >> shift;
+        int latticeWidth = (int) (((x0 + TILE_RESOLUTION) >> shift) - lx) + 2;
+        int latticeHeight = (int) (((y0 + TILE_RESOLUTION) >> shift) - ly) + 2;
+        uint64_t key = octaveKeys[octave];
+
+        lattice.resize(latticeWidth * latticeHeight);
+        for (int j = 0; j < latticeHeight; j++) {
+            for (int i = 0; i < latticeWidth; i++) {
+                lattice[j * latticeWidth + i] = RandomFloat(keyOf(lx + i, ly + j), key, -1.0f, 1.0f);
+            }
+        }
+        for (int i = 0; i < size; i++) {
+            cells[i] = (int) (((x0 + i) >> shift) - lx);
+            weights[i] = smoothWeight((x0 + i) & mask, shift);
+        }
+
+        for (int j = 0; j < size; j++) {
+            const float *bottom = &lattice[(((y0 + j) >> shift) - ly) * latticeWidth];
+            const float *top = bottom + latticeWidth;
+            float wy = smoothWeight((y0 + j) & mask, shift);
+            float *row = &tile.heights[j * size];
+            for (int i = 0; i < size; i++) {
+                int c = cells[i];
+                row[i] += amplitude * blend(bottom[c], bottom[c + 1], top[c], top[c + 1], weights[i], wy);
+            }
+        }
+        amplitude /= 2.0f;
+    }
+
+    for (int i = 0; i < size * size; i++) {
+        tile.heights[i] = TERRAIN_BASE + TERRAIN_RANGE * tile.heights[i];
+    }
+}
+
+float TerrainStreamer::GetHeight(float x, float y) const
+{
+    float sx = x / TILE_WORLD_SIZE * TILE_RESOLUTION;
+    float sy = y / TILE_WORLD_SIZE * TILE_RESOLUTION;
+    float fx = floorf(sx);
+    float fy = floorf(sy);
+    int64_t ix = (int64_t) fx;
+    int64_t iy = (int64_t) fy;
+
+    return blend(SampleHeight(ix, iy), SampleHeight(ix + 1, iy),
+                 SampleHeight(ix, iy + 1), SampleHeight(ix + 1, iy + 1),
+                 sx - fx, sy - fy);
+}
+
+mat4 TerrainStreamer::GetGridTransform() const
+{
+    return translate(mat4(1), vec3((centerX + 0.5f) * TILE_WORLD_SIZE,
+                                   (centerY + 0.5f) * TILE_WORLD_SIZE, 0));
+}
+
+void TerrainStreamer::Insert(Tile *tile)
+{
+    uint64_t key = keyOf(tile->x, tile->y);
+    lru.push_front(key);
+    CacheEntry entry;
+    entry.tile = tile;
+    entry.position = lru.begin();
+    cache[key] = entry;
+    stats.cacheBytes += sizeof(Tile) + tile->heights.size() * sizeof(float);
+}
+
+bool TerrainStreamer::Touch(uint64_t key)
+{
+    unordered_map<uint64_t, CacheEntry>::iterator it = cache.find(key);
+    if (it == cache.end())
+        return false;
+    lru.splice(lru.begin(), lru, it->second.position);
+    return true;
+}
+
+void TerrainStreamer::Evict()
+{
+    while (stats.cacheBytes > TILE_CACHE_BUDGET && !lru.empty()) {
+        uint64_t key = lru.back();
+        lru.pop_back();
+        Tile *tile = cache[key].tile;
+        cache.erase(key);
+        stats.cacheBytes -= sizeof(Tile) + tile->heights.size() * sizeof(float);
+        stats.tilesEvicted++;
+        delete tile;
+    }
+}
+
+bool TerrainStreamer::Request(int x, int y)
+{
+    uint64_t key = keyOf(x, y);
+    if (cache.count(key) || pending.count(key))
+        return false;
+    if (pending.size() >= TILE_MAX_IN_FLIGHT)
+        return false;
+
+    Tile *tile = new Tile();
+    tile->x = x;
+    tile->y = y;
+    pending[key] = true;
+    workers->Submit([this, tile]() {
+        Generate(*tile);
+        lock_guard<mutex> lock(finishedMutex);
+        finished.push_back(tile);
+    });
+    return true;
+}
+
+int TerrainStreamer::AllocateLayer()
+{
+    if (!freeLayers.empty()) {
+        int layer = freeLayers.back();
+        freeLayers.pop_back();
+        return layer;
+    }
+
+    // Reuse the layer that has gone unused the longest,
+    // as long as nothing needed it this frame
+    int oldest = -1;
+    for (int layer = 0; layer < TILE_GPU_LAYERS; layer++) {
+        if (layerLastUsed[layer] < frame &&
+            (oldest < 0 || layerLastUsed[layer] < layerLastUsed[oldest]))
+            oldest = layer;
+    }
+    if (oldest >= 0)
+        resident.erase(layerOwners[oldest]);
+    return oldest;
+}
+
+bool TerrainStreamer::Upload(const Tile& tile)
+{
+    int layer = AllocateLayer();
+    if (layer < 0)
+        return false;
+
+    int size = TILE_RESOLUTION + 1;
+    glBindTexture(GL_TEXTURE_2D_ARRAY_EXT, textureArray);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY_EXT, 0, 0, 0, layer, size, size, 1,
+                    GL_RED, GL_FLOAT, &tile.heights[0]);
+    glBindTexture(GL_TEXTURE_2D_ARRAY_EXT, 0);
+
+    uint64_t key = keyOf(tile.x, tile.y);
+    resident[key] = layer;
+    layerOwners[layer] = key;
+    layerLastUsed[layer] = frame;
+    stats.tilesUploaded++;
+    return true;
+}
+
+void TerrainStreamer::UpdateWindow()
+{
+    for (int y = 0; y < TILE_WINDOW; y++) {
+        for (int x = 0; x < TILE_WINDOW; x++) {
+            uint64_t key = keyOf(centerX - TILE_RING_RADIUS + x, centerY - TILE_RING_RADIUS + y);
+            unordered_map<uint64_t, int>::iterator it = resident.find(key);
+            windowLayers[y * TILE_WINDOW + x] = (it != resident.end()) ? it->second : -1.0f;
+        }
+    }
+}
+
+/** A tile wanted this frame, and how urgently */
+struct WantedTile
+{
+    int x, y;
+    float priority;
+    bool operator<(const WantedTile& other) const { return priority < other.priority; }
+};
+
+void TerrainStreamer::Update(vec3 position, vec3 velocity)
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    frame++;
+    stats.frames++;
+
+    centerX = (int) floorf(position.x / TILE_WORLD_SIZE);
+    centerY = (int) floorf(position.y / TILE_WORLD_SIZE);
+
+    // Collect tiles the workers have finished
+    vector<Tile *> done;
+    {
+        lock_guard<mutex> lock(finishedMutex);
+        done.swap(finished);
+    }
+    for (size_t i = 0; i < done.size(); i++) {
+        pending.erase(keyOf(done[i]->x, done[i]->y));
+        Insert(done[i]);
+        stats.tilesGenerated++;
+    }
+
+    // Everything in the window is wanted first, nearest first. Then the
+    // windows along the way to where the walker will be
+    // TILE_PREFETCH_SECONDS from now, nearest to the walker first.
+    vec3 ahead = position + velocity * TILE_PREFETCH_SECONDS;
+    int aheadX = (int) floorf(ahead.x / TILE_WORLD_SIZE);
+    int aheadY = (int) floorf(ahead.y / TILE_WORLD_SIZE);
+    int steps = std::max(abs(aheadX - centerX), abs(aheadY - centerY));
+    vector<WantedTile> wanted;
+    unordered_set<uint64_t> seen;
+    for (int step = 0; step <= steps; step++) {
+        int cx = centerX, cy = centerY;
+        if (step > 0) {
+            cx += (int) floorf((aheadX - centerX) * step / (float) steps + 0.5f);
+            cy += (int) floorf((aheadY - centerY) * step / (float) steps + 0.5f);
+        }
+        for (int y = cy - TILE_RING_RADIUS; y <= cy + TILE_RING_RADIUS; y++) {
+            for (int x = cx - TILE_RING_RADIUS; x <= cx + TILE_RING_RADIUS; x++) {
+                if (!seen.insert(keyOf(x, y)).second)
+                    continue;
+                WantedTile tile;
+                tile.x = x;
+                tile.y = y;
+                float dx = (x + 0.5f) * TILE_WORLD_SIZE - position.x;
+                float dy = (y + 0.5f) * TILE_WORLD_SIZE - position.y;
+                tile.priority = (step > 0) * 1e6f + dx * dx + dy * dy;
+                wanted.push_back(tile);
+            }
+        }
+    }
+    sort(wanted.begin(), wanted.end());
+
+    // Walk the list back to front so the most urgent tiles end up most
+    // recently used, and pin the layers of wanted tiles already on the
+    // GPU so uploads below cannot take them
+    for (size_t i = wanted.size(); i-- > 0; ) {
+        uint64_t key = keyOf(wanted[i].x, wanted[i].y);
+        Touch(key);
+        unordered_map<uint64_t, int>::iterator layer = resident.find(key);
+        if (layer != resident.end())
+            layerLastUsed[layer->second] = frame;
+    }
+
+    // Then request and upload the rest, most urgent first
+    bool uploaded = false;
+    for (size_t i = 0; i < wanted.size(); i++) {
+        uint64_t key = keyOf(wanted[i].x, wanted[i].y);
+        if (resident.count(key))
+            continue;
+
+        unordered_map<uint64_t, CacheEntry>::iterator cached = cache.find(key);
+        if (cached == cache.end()) {
+            Request(wanted[i].x, wanted[i].y);
+        }
+        else if (!uploaded || millisecondsSince(start) < TILE_FRAME_BUDGET_MS) {
+            uploaded = Upload(*cached->second.tile) || uploaded;
+        }
+    }
+
+    Evict();
+    UpdateWindow();
+
+    double elapsed = millisecondsSince(start);
+    stats.worstUpdateMs = std::max(stats.worstUpdateMs, elapsed);
+    if (elapsed > TILE_FRAME_BUDGET_MS)
+        stats.framesOverBudget++;
+}
+
+void TerrainStreamer::SetUniforms(const Program& program, GLenum unit) const
+{
+    glActiveTexture(unit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY_EXT, textureArray);
+    glUniform1i(program.GetUniformLocation("tiles"), unit - GL_TEXTURE0);
+    glUniform1fv(program.GetUniformLocation("tileLayers"), TILE_WINDOW * TILE_WINDOW, windowLayers);
+    program.SetUniform("tileOrigin", vec2((centerX - TILE_RING_RADIUS) * TILE_WORLD_SIZE,
+                                          (centerY - TILE_RING_RADIUS) * TILE_WORLD_SIZE));
+    program.SetUniform("tileSize", TILE_WORLD_SIZE);
+    program.SetUniform("tileResolution", (GLfloat) TILE_RESOLUTION);
+}
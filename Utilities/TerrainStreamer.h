@@ -0,0 +1,151 @@
+#pragma once
+
+#ifdef __APPLE__
+#include <GLUT/glut.h>
+#else
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <GL/glut.h>
+#endif
+
+#include <stdint.h>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Program.h"
+#include "ThreadPool.h"
+
+/* Tile layout. TILE_RING_RADIUS must match TILE_WINDOW in Shaders/terrain.vert
+   (TILE_WINDOW = 2 * TILE_RING_RADIUS + 1). */
+#define TILE_RESOLUTION 128
+#define TILE_WORLD_SIZE 0.5f
+#define TILE_RING_RADIUS 2
+#define TILE_WINDOW (2 * TILE_RING_RADIUS + 1)
+
+/* Streaming budgets */
+#define TILE_GPU_LAYERS (4 * TILE_WINDOW * TILE_WINDOW)
+#define TILE_CACHE_BUDGET (32 * 1024 * 1024)
+#define TILE_MAX_IN_FLIGHT 8
+#define TILE_FRAME_BUDGET_MS 1.0
+#define TILE_PREFETCH_SECONDS 1.5f
+
+/* Procedural heights: lattice spacings from 2^TERRAIN_OCTAVES samples down to 2 */
+#define TERRAIN_OCTAVES 8
+
+/** Counters for judging how well streaming keeps up */
+struct TerrainStreamStats
+{
+    TerrainStreamStats() :
+        tilesGenerated(0), tilesUploaded(0), tilesEvicted(0),
+        cacheBytes(0), worstUpdateMs(0), framesOverBudget(0), frames(0) {}
+
+    int tilesGenerated;
+    int tilesUploaded;
+    int tilesEvicted;
+    size_t cacheBytes;
+    double worstUpdateMs;
+    int framesOverBudget;
+    int frames;
+};
+
+/** Endless procedural terrain, generated in tiles around the walker.
+
+    Heights are a pure function of world position (value noise keyed by
+    a seed and global sample coordinates), so neighbouring tiles line up
+    exactly and a tile can be regenerated at any time. Tiles are built
+    on worker threads, kept in an LRU cache with a memory budget, and
+    uploaded into a fixed ring of texture array layers a few per frame.
+    Memory stays flat however far the walker goes.
+
+    The terrain.vert shader looks tiles up through a small window of
+    layer indices centered on the walker's tile; see SetUniforms. */
+class TerrainStreamer
+{
+public:
+    /** Creates the streamer and synchronously builds the window of
+        tiles around the starting position, so the first frame is
+        complete. */
+    TerrainStreamer(uint32_t seed, glm::vec3 start);
+    ~TerrainStreamer();
+
+    /** Called once a frame with the walker's position and velocity
+        (world units per second). Requests missing tiles around the
+        walker and ahead of it, collects finished ones and uploads as
+        many as fit in the frame budget. */
+    void Update(glm::vec3 position, glm::vec3 velocity);
+
+    /** Binds the tile array to the given unit and sets the lookup
+        uniforms the terrain shader needs */
+    void SetUniforms(const Program& program, GLenum unit) const;
+
+    /** Returns the terrain height (0 to 1) at a world position,
+        interpolated the same way the GPU filters the tiles */
+    float GetHeight(float x, float y) const;
+
+    /** Returns the model transform that keeps the terrain grid
+        centered under the walker */
+    glm::mat4 GetGridTransform() const;
+
+    const TerrainStreamStats& GetStats() const { return stats; }
+
+private:
+    struct Tile
+    {
+        int x, y;
+        std::vector<float> heights;
+    };
+
+    typedef std::list<uint64_t> LRUList;
+    struct CacheEntry
+    {
+        Tile *tile;
+        LRUList::iterator position;
+    };
+
+    /** Height of a global sample before interpolation */
+    float SampleHeight(int64_t x, int64_t y) const;
+
+    /** Fills a tile's heights. Safe to call from any thread. */
+    void Generate(Tile& tile) const;
+
+    /** Cache bookkeeping */
+    void Insert(Tile *tile);
+    bool Touch(uint64_t key);
+    void Evict();
+
+    /** Requests a tile from the workers unless it is cached or pending */
+    bool Request(int x, int y);
+
+    /** Copies a cached tile into a texture layer */
+    bool Upload(const Tile& tile);
+    int AllocateLayer();
+
+    /** Recomputes which layer each window slot samples from */
+    void UpdateWindow();
+
+    uint64_t octaveKeys[TERRAIN_OCTAVES];
+
+    int centerX, centerY;
+    int frame;
+
+    std::unordered_map<uint64_t, CacheEntry> cache;
+    LRUList lru;
+    std::unordered_map<uint64_t, bool> pending;
+
+    std::unordered_map<uint64_t, int> resident;
+    std::vector<uint64_t> layerOwners;
+    std::vector<int> layerLastUsed;
+    std::vector<int> freeLayers;
+    GLfloat windowLayers[TILE_WINDOW * TILE_WINDOW];
+    GLuint textureArray;
+
+    std::mutex finishedMutex;
+    std::vector<Tile *> finished;
+
+    TerrainStreamStats stats;
+
+    ThreadPool *workers;
+};
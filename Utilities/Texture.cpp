@@ -1,8 +1,102 @@
 #include "Texture.h"
+#include "NormalMap.h"
+#include "Trace.h"
 
 using namespace::std;
 using namespace::glm;
 
+/** A sized internal format, and how much space it takes */
+struct StorageFormat
+{
+    GLenum storage;
+    const char *name;
+    int channels;
+    int bytesPerTexel;
+};
+
+static const StorageFormat storageFormats[] = {
+    { GL_R8,    "R8",    1, 1 },
+    { GL_R16,   "R16",   1, 2 },
+    { GL_R16F,  "R16F",  1, 2 },
+    { GL_RG8,   "RG8",   2, 2 },
+    { GL_RGB8,  "RGB8",  3, 3 },
+    { GL_SRGB8, "SRGB8", 3, 3 },
+    { GL_RGBA8, "RGBA8", 4, 4 },
+};
+
+static const StorageFormat *findStorage(GLenum storage)
+{
+    for (size_t i = 0; i < sizeof(storageFormats) / sizeof(storageFormats[0]); i++) {
+        if (storageFormats[i].storage == storage)
+            return &storageFormats[i];
+    }
+    return NULL;
+}
+
+/** Pixel format with the given number of channels, in RGBA order */
+static GLenum channelFormat(int channels)
+{
+    switch (channels) {
+        case 1: return GL_RED;
+        case 2: return GL_RG;
+        case 3: return GL_RGB;
+        default: return GL_RGBA;
+    }
+}
+
+/** Allocates a single level of the bound texture. Immutable storage
+    is used where available, so the driver can skip completeness
+    checks; otherwise the same sized format is requested the old way. */
+static void allocateStorage(const StorageFormat& format, GLsizei width, GLsizei height)
+{
+#ifndef __APPLE__
+    if (GLEW_ARB_texture_storage) {
+        GLint immutable = 0;
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_IMMUTABLE_FORMAT, &immutable);
+        if (!immutable)
+            glTexStorage2D(GL_TEXTURE_2D, 1, format.storage, width, height);
+        return;
+    }
+#endif
+    glTexImage2D(GL_TEXTURE_2D, 0, format.storage, width, height, 0,
+                 channelFormat(format.channels), GL_UNSIGNED_BYTE, NULL);
+}
+
+/** Uploads a BGR bitmap into sized storage. One channel formats get
+    the average of the color channels, two channel formats red and green. */
+static void uploadBitmap(const StorageFormat& format, bitmap_image *bitmap)
+{
+    const unsigned char *in = bitmap->data();
+    size_t count = (size_t) bitmap->width() * bitmap->height();
+    GLsizei width = bitmap->width(), height = bitmap->height();
+    
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (format.channels == 1 && format.storage == GL_R8) {
+        vector<unsigned char> pixels(count);
+        for (size_t i = 0; i < count; i++)
+            pixels[i] = (in[3 * i] + in[3 * i + 1] + in[3 * i + 2] + 1) / 3;
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RED, GL_UNSIGNED_BYTE, &pixels[0]);
+    }
+    else if (format.channels == 1) {
+        vector<GLfloat> pixels(count);
+        for (size_t i = 0; i < count; i++)
+            pixels[i] = (in[3 * i] + in[3 * i + 1] + in[3 * i + 2]) / 765.0f;
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RED, GL_FLOAT, &pixels[0]);
+    }
+    else if (format.channels == 2) {
+        vector<unsigned char> pixels(2 * count);
+        for (size_t i = 0; i < count; i++) {
+            pixels[2 * i] = in[3 * i + 2];
+            pixels[2 * i + 1] = in[3 * i + 1];
+        }
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RG, GL_UNSIGNED_BYTE, &pixels[0]);
+    }
+    else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_BGR, GL_UNSIGNED_BYTE, in);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
 Texture::Texture(GLenum format) :
     Texture(0, 0, format)
 {
@@ -13,11 +107,13 @@ Texture::Texture(GLfloat width, GLfloat height, GLenum format) :
 {
 }
 
-Texture::Texture(GLfloat width, GLfloat height, GLenum format, GLfloat data[])
+Texture::Texture(GLfloat width, GLfloat height, GLenum format, GLfloat data[], GLenum storage)
+: owner(ResourceRegistry::GetOwner())
 {
     Texture::width = width;
     Texture::height = height;
     Texture::format = format;
+    Texture::storage = storage;
     glGenTextures(1, &id);
     Texture::data = data;
     bitmap = NULL;
@@ -25,26 +121,41 @@ Texture::Texture(GLfloat width, GLfloat height, GLenum format, GLfloat data[])
 }
 
 Texture::Texture(bitmap_image *image)
+: owner(ResourceRegistry::GetOwner())
 {
     bitmap = image;
     width = bitmap->width();
     height = bitmap->height();
+    format = GL_RGB;
+    storage = 0;
+    glGenTextures(1, &id);
     Bind();
 }
 
-Texture::Texture(string filename)
+Texture::Texture(string filename, GLenum storage)
+: owner(filename)
 {
-    bitmap = new bitmap_image(filename);
+    {
+        TRACE_SCOPE("load", "Decode texture");
+        bitmap = new bitmap_image(filename);
+    }
     width = bitmap->width();
     height = bitmap->height();
+    format = GL_RGB;
+    Texture::storage = storage;
+    glGenTextures(1, &id);
     Bind();
 }
 
 Texture::~Texture()
 {
     glDeleteTextures(1, &id);
-    if (bitmap)
+    ResourceRegistry::Remove(RESOURCE_TEXTURE, id);
+    ResourceRegistry::Remove(RESOURCE_RENDER_TARGET, id);
+    if (bitmap) {
+        ResourceRegistry::Remove(RESOURCE_IMAGE, (uintptr_t) bitmap);
         delete bitmap;
+    }
 }
 
 const unsigned char *Texture::GetData()
@@ -62,39 +173,65 @@ GLuint Texture::GetID()
     return id;
 }
 
-Texture *Texture::GetNormalMap()
+size_t Texture::GetMemoryUsage()
 {
-    bitmap_image *image = new bitmap_image(bitmap->width(), bitmap->height());
-    for (int x = 0; x < bitmap->width(); x++)
-    {
-        for (int y = 0; y < bitmap->height(); y++)
-        {
-            // Approximate gradient
-            float dx = (bitmap->get_height(x + 1, y) - bitmap->get_height(x - 1, y)) / 2.0f;
-            float dy = (bitmap->get_height(x, y + 1) - bitmap->get_height(x, y - 1)) / 2.0f;
-            
-            // Some encoding necessary
-            // Normal coordinates can be from -1 to 1
-            // We need to change it to the range 0 to 1
-            vec3 x_dir = vec3(1, 0, 70 * dx);
-            vec3 y_dir = vec3(0, 1, 70 * dy);
-            vec3 normal = normalize(cross(x_dir, y_dir)) / 2.0f;
-            normal += vec3(0.5);
-            
-            unsigned char r = 255 * normal.r;
-            unsigned char g = 255 * normal.g;
-            unsigned char b = 255 * normal.b;
-            image->set_pixel(x, y, r, g, b);
-        }
+    const StorageFormat *sized = findStorage(storage);
+    if (!sized)
+        return GetLegacyMemoryUsage();
+    return (size_t) width * height * sized->bytesPerTexel;
+}
+
+size_t Texture::GetLegacyMemoryUsage()
+{
+    // Bitmaps went up as GL_RGB; float data, render targets and
+    // depth as GL_RGBA or 32 bit depth
+    return (size_t) width * height * (format == GL_RGB ? 3 : 4);
+}
+
+void Texture::ReportMemory(const string& name)
+{
+    const StorageFormat *sized = findStorage(storage);
+    float megabyte = 1024 * 1024;
+    cout << "  " << name << ": " << width << "x" << height << " "
+         << (sized ? sized->name : "unsized") << ", "
+         << GetMemoryUsage() / megabyte << " MB ("
+         << (GetLegacyMemoryUsage() - GetMemoryUsage()) / megabyte << " MB saved)" << endl;
+}
+
+void Texture::Account()
+{
+    const StorageFormat *sized = findStorage(storage);
+    const char *name = sized ? sized->name : format == GL_DEPTH_COMPONENT ? "DEPTH32"
+                                           : format == GL_RGB ? "RGB" : "RGBA";
+    
+    // Storage with nothing uploaded is drawn into
+    ResourceCategory category = (sized || bitmap || data) ? RESOURCE_TEXTURE : RESOURCE_RENDER_TARGET;
+    ResourceRegistry::Add(category, id, GetMemoryUsage(), name, owner);
+    if (bitmap) {
+        ResourceRegistry::Add(RESOURCE_IMAGE, (uintptr_t) bitmap,
+                              (size_t) bitmap->width() * bitmap->height() * bitmap->bytes_per_pixel(),
+                              "BGR8", owner);
     }
-    image->save_image("Textures/normals.bmp");
-    return new Texture(image);
+}
+
+Texture *Texture::GetNormalMap()
+{
+    HeightField<float> heights(bitmap);
+    return new NormalMap(heights);
 }
 
 void Texture::Bind()
 {
     glBindTexture(GL_TEXTURE_2D, id);
-    if (bitmap) {
+    const StorageFormat *sized = findStorage(storage);
+    if (sized) {
+        allocateStorage(*sized, (GLsizei) width, (GLsizei) height);
+        if (bitmap)
+            uploadBitmap(*sized, bitmap);
+        else if (data)
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, (GLsizei) width, (GLsizei) height, format, GL_FLOAT, data);
+    }
+    else if (bitmap) {
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE, bitmap->data());
     }
     else if (data) {
@@ -111,4 +248,5 @@ void Texture::Bind()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glBindTexture(GL_TEXTURE_2D, 0);
+    Account();
 }
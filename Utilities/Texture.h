@@ -13,16 +13,27 @@
 #include <string>
 #include <glm/glm.hpp>
 #include "bitmap_image.hpp"
+#include "ResourceRegistry.h"
 
+/** Textures can be given a sized internal format (storage) such as
+    GL_R8, GL_R16, GL_R16F, GL_RG8, GL_RGB8, GL_SRGB8 or GL_RGBA8. They
+    are then allocated once with immutable storage where supported, and
+    bitmaps are converted to the right number of channels on upload
+    (single channel formats average the color channels). A storage of 0
+    keeps the old unsized formats.
+
+    Textures record their memory, and that of the bitmap they keep, in
+    the ResourceRegistry. Textures from files are owned by the file;
+    others by the ResourceOwner in scope when they are made. */
 class Texture
 {
 public:
     Texture(GLenum format);
     Texture(GLfloat width, GLfloat height, GLenum format);
-    Texture(GLfloat width, GLfloat height, GLenum format, GLfloat data[]);
+    Texture(GLfloat width, GLfloat height, GLenum format, GLfloat data[], GLenum storage = 0);
     Texture(bitmap_image *image);
-    Texture(std::string filename);
-    ~Texture();
+    Texture(std::string filename, GLenum storage = 0);
+    virtual ~Texture();
     
     /** Returns the image data */
     virtual const unsigned char *GetData();
@@ -36,19 +47,33 @@ public:
     virtual void Bind();
     
     /** Returns a normal map created by interpreting
-     this texture as a height map */
+     this texture as a height map. Nothing is written
+     to disk; see NormalMap::Save. */
     Texture *GetNormalMap();
     
     /** Returns the texture's id */
     GLuint GetID();
     
+    /** Returns the GPU memory taken by the texture, in bytes, and what
+        it would have taken in the old unsized format */
+    size_t GetMemoryUsage();
+    size_t GetLegacyMemoryUsage();
+    
+    /** Prints the texture's size, format and memory use to stdout */
+    void ReportMemory(const std::string& name);
+    
 protected:
-    Texture() {}
+    Texture() : storage(0), owner(ResourceRegistry::GetOwner()) {}
+    
+    /** Records the texture's current storage in the registry */
+    void Account();
     
     GLfloat width, height;
     GLfloat *data;
     GLuint id;
     GLenum format;
+    GLenum storage;
     
     bitmap_image *bitmap;
+    std::string owner;
 };
@@ -0,0 +1,133 @@
+#include "ThreadPool.h"
+#include "Trace.h"
+
+#include <atomic>
+#include <memory>
+
+using namespace std;
+
+ThreadPool::ThreadPool(int threadCount)
+: stopping(false)
+{
+    if (threadCount <= 0)
+        threadCount = thread::hardware_concurrency();
+    if (threadCount <= 0)
+        threadCount = 1;
+
+    for (int i = 0; i < threadCount; i++) {
+        workers.push_back(thread(&ThreadPool::Work, this));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    available.notify_all();
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+}
+
+void ThreadPool::Submit(const function<void()>& task)
+{
+    {
+        lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(task);
+    }
+    available.notify_one();
+}
+
+/** Bookkeeping shared between ParallelFor and its helper tasks. Helpers
+    may start after the loop is over, so this outlives the call. */
+struct ParallelForState
+{
+    atomic<size_t> next;
+    size_t chunks;
+    size_t count;
+    size_t grain;
+    function<void(size_t, size_t)> fn;
+
+    std::mutex mutex;
+    condition_variable finished;
+    size_t done;
+
+    /** Runs chunks until there are none left */
+    void Run() {
+        size_t completed = 0;
+        for (size_t chunk = next++; chunk < chunks; chunk = next++) {
+            size_t begin = chunk * grain;
+            size_t end = (begin + grain < count) ? begin + grain : count;
+            fn(begin, end);
+            completed++;
+        }
+        if (completed) {
+            lock_guard<std::mutex> lock(mutex);
+            done += completed;
+            if (done == chunks)
+                finished.notify_all();
+        }
+    }
+};
+
+void ThreadPool::ParallelFor(size_t count, size_t grain,
+                             const function<void(size_t, size_t)>& fn)
+{
+    if (count == 0)
+        return;
+    if (grain == 0)
+        grain = 1;
+
+    size_t chunks = (count + grain - 1) / grain;
+    if (chunks == 1) {
+        fn(0, count);
+        return;
+    }
+
+    shared_ptr<ParallelForState> state = make_shared<ParallelForState>();
+    state->next = 0;
+    state->chunks = chunks;
+    state->count = count;
+    state->grain = grain;
+    state->fn = fn;
+    state->done = 0;
+
+    size_t helpers = (chunks - 1 < workers.size()) ? chunks - 1 : workers.size();
+    for (size_t i = 0; i < helpers; i++) {
+        Submit([state]() { state->Run(); });
+    }
+    state->Run();
+
+    unique_lock<std::mutex> lock(state->mutex);
+    while (state->done < state->chunks) {
+        state->finished.wait(lock);
+    }
+}
+
+ThreadPool& ThreadPool::Default()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::Work()
+{
+    Trace::SetThreadName("worker");
+    while (true) {
+        function<void()> task;
+        {
+            unique_lock<std::mutex> lock(mutex);
+            while (!stopping && tasks.empty()) {
+                available.wait(lock);
+            }
+            if (stopping && tasks.empty())
+                return;
+            task = tasks.front();
+            tasks.pop_front();
+        }
+        TRACE_SCOPE("task", "Task");
+        task();
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** A fixed set of worker threads pulling tasks off a shared queue.
+    Used for batched CPU work (ray casts, terrain and normal map
+    generation) so it can scale across cores. */
+class ThreadPool
+{
+public:
+    /** Creates a pool with the given number of workers. Zero means
+        one worker per hardware thread. */
+    ThreadPool(int threadCount = 0);
+    ~ThreadPool();
+
+    /** Returns the number of worker threads */
+    int GetThreadCount() const { return (int) workers.size(); }
+
+    /** Queues a task to run on one of the workers */
+    void Submit(const std::function<void()>& task);
+
+    /** Splits [0, count) into chunks of (at most) grain items and runs
+        fn(begin, end) on each of them. The calling thread helps out,
+        and the call returns once every chunk is done. */
+    void ParallelFor(size_t count, size_t grain,
+                     const std::function<void(size_t, size_t)>& fn);
+
+    /** Returns a pool shared by the whole program */
+    static ThreadPool& Default();
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()> > tasks;
+    std::mutex mutex;
+    std::condition_variable available;
+    bool stopping;
+
+    void Work();
+};
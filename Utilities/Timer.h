@@ -0,0 +1,30 @@
+#pragma once
+
+#include <chrono>
+
+/** Wall clock stopwatch, in milliseconds */
+class Timer
+{
+public:
+    Timer() { Start(); }
+    
+    /** Restarts the timer */
+    void Start() { start = std::chrono::steady_clock::now(); }
+    
+    /** Returns the milliseconds since the timer was (re)started */
+    double GetElapsed() const {
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    }
+    
+    /** Returns the elapsed milliseconds and restarts the timer */
+    double Lap() {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        std::chrono::duration<double, std::milli> elapsed = now - start;
+        start = now;
+        return elapsed.count();
+    }
+    
+private:
+    std::chrono::steady_clock::time_point start;
+};
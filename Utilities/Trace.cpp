@@ -0,0 +1,145 @@
+#include "Trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    /** A finished span */
+    struct Event
+    {
+        const char *category;
+        const char *name;
+        double start;
+        double duration;
+    };
+
+    /** One thread's events. Only the owning thread adds to it; the
+        count is published after each event is filled in. */
+    struct Buffer
+    {
+        Buffer(int thread) : thread(thread), name(NULL), count(0), dropped(0)
+        {
+            events = new Event[TRACE_BUFFER_EVENTS];
+        }
+
+        int thread;
+        atomic<const char *> name;
+        Event *events;
+        atomic<size_t> count;
+        atomic<long> dropped;
+    };
+
+    chrono::steady_clock::time_point Started = chrono::steady_clock::now();
+    atomic<bool> Recording(false);
+
+    /* Every thread's buffer, in the order they first recorded */
+    mutex BuffersMutex;
+    vector<Buffer *> Buffers;
+
+    thread_local Buffer *Local = NULL;
+    thread_local const char *LocalName = NULL;
+
+    /** Returns the calling thread's buffer, making it on first use */
+    Buffer *GetBuffer()
+    {
+        if (!Local) {
+            lock_guard<mutex> lock(BuffersMutex);
+            Local = new Buffer((int) Buffers.size() + 1);
+            Local->name = LocalName;
+            Buffers.push_back(Local);
+        }
+        return Local;
+    }
+}
+
+namespace Trace
+{
+    void Start()
+    {
+        Recording = true;
+    }
+
+    bool IsRecording()
+    {
+        return Recording.load(memory_order_relaxed);
+    }
+
+    void SetThreadName(const char *name)
+    {
+        LocalName = name;
+        if (Local)
+            Local->name = name;
+    }
+
+    double Now()
+    {
+        chrono::duration<double, micro> elapsed = chrono::steady_clock::now() - Started;
+        return elapsed.count();
+    }
+
+    void Record(const char *category, const char *name, double start, double duration)
+    {
+        Buffer *buffer = GetBuffer();
+        size_t count = buffer->count.load(memory_order_relaxed);
+        if (count == TRACE_BUFFER_EVENTS) {
+            buffer->dropped++;
+            return;
+        }
+        Event& event = buffer->events[count];
+        event.category = category;
+        event.name = name;
+        event.start = start;
+        event.duration = duration;
+        buffer->count.store(count + 1, memory_order_release);
+    }
+
+    bool Write(const string& path)
+    {
+        ofstream out(path.c_str());
+        if (!out) {
+            cerr << "Warning: unable to write the trace to " << path << endl;
+            return false;
+        }
+
+        lock_guard<mutex> lock(BuffersMutex);
+        out << fixed << setprecision(3);
+        out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" << endl;
+        out << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, "
+            << "\"args\": {\"name\": \"A Walk on Mars\"}}";
+
+        long dropped = 0;
+        for (size_t i = 0; i < Buffers.size(); i++) {
+            Buffer *buffer = Buffers[i];
+            const char *name = buffer->name;
+            out << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->thread
+                << ", \"args\": {\"name\": \"";
+            if (name)
+                out << name;
+            else
+                out << "thread " << buffer->thread;
+            out << "\"}}";
+
+            size_t count = buffer->count.load(memory_order_acquire);
+            for (size_t j = 0; j < count; j++) {
+                const Event& event = buffer->events[j];
+                out << ",\n{\"name\": \"" << event.name << "\", \"cat\": \"" << event.category
+                    << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->thread
+                    << ", \"ts\": " << event.start << ", \"dur\": " << event.duration << "}";
+            }
+            dropped += buffer->dropped;
+        }
+        out << "\n]}" << endl;
+
+        if (dropped)
+            cerr << "Warning: the trace is missing " << dropped << " events that didn't fit" << endl;
+        return true;
+    }
+}
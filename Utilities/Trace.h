@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+
+/* Set to 0 to compile the trace scopes out entirely */
+#ifndef ENABLE_TRACING
+#define ENABLE_TRACING 1
+#endif
+
+/* Events each thread can hold; later ones are dropped and counted */
+#define TRACE_BUFFER_EVENTS 65536
+
+/** Timeline tracing, saved in the Chrome trace event format so a
+    session can be opened in chrome://tracing or Perfetto to look for
+    stalls and idle threads.
+
+    Code marks spans with TRACE_SCOPE. While recording, each span is
+    kept as one complete event in a buffer belonging to the thread
+    that ran it, so recording takes no locks; a thread only takes one
+    the first time it records, to make its buffer known. Buffers
+    outlive their threads, and Write may be called while other
+    threads are still recording. When not recording, a scope costs a
+    flag check. */
+namespace Trace
+{
+    /** Starts recording */
+    void Start();
+
+    /** Returns whether spans are being recorded */
+    bool IsRecording();
+
+    /** Names the calling thread in the trace; the name must be a
+        string literal, as only its pointer is kept */
+    void SetThreadName(const char *name);
+
+    /** Microseconds from the start of the program */
+    double Now();
+
+    /** Adds a span that ran on the calling thread. The category and
+        name must be string literals. */
+    void Record(const char *category, const char *name, double start, double duration);
+
+    /** Writes everything recorded so far. Returns false if the file
+        can't be written. */
+    bool Write(const std::string& path);
+}
+
+/** Records the rest of the enclosing block as a span */
+class TraceScope
+{
+public:
+    TraceScope(const char *category, const char *name)
+    : category(category), name(name), start(Trace::IsRecording() ? Trace::Now() : -1)
+    {
+    }
+
+    ~TraceScope()
+    {
+        if (start >= 0)
+            Trace::Record(category, name, start, Trace::Now() - start);
+    }
+
+private:
+    const char *category;
+    const char *name;
+    double start;
+};
+
+#if ENABLE_TRACING
+#define TRACE_CONCATENATE(a, b) a##b
+#define TRACE_NAME(line) TRACE_CONCATENATE(traceScope, line)
+#define TRACE_SCOPE(category, name) TraceScope TRACE_NAME(__LINE__)(category, name)
+#else
+#define TRACE_SCOPE(category, name) do {} while (0)
+#endif
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+
+/** Lock-free handoff of the latest value from one producer thread to
+    one consumer thread.
+
+    The producer fills the back slot and publishes it; the consumer
+    acquires the most recently published slot as its front. Neither
+    side ever waits for the other: the producer always has a slot to
+    write, and the consumer keeps its front until something newer
+    arrives. Values published while the consumer was busy are skipped,
+    never queued. */
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() : middle(1), front(0), back(2) {}
+    
+    /** Producer: the slot to fill next */
+    T& GetBack() { return slots[back]; }
+    
+    /** Producer: makes the back slot the latest value, and takes the
+        spare slot as the new back */
+    void Publish()
+    {
+        back = middle.exchange(back | FRESH) & INDEX;
+    }
+    
+    /** Returns whether a value was published since the last Acquire */
+    bool HasFresh() const { return (middle.load() & FRESH) != 0; }
+    
+    /** Consumer: moves the latest value to the front. Returns false,
+        keeping the old front, if nothing new was published. */
+    bool Acquire()
+    {
+        if (!HasFresh())
+            return false;
+        front = middle.exchange(front) & INDEX;
+        return true;
+    }
+    
+    /** Consumer: the value acquired last */
+    T& GetFront() { return slots[front]; }
+    
+    /** Gives direct access to all three slots, for setting up and
+        tearing down while neither thread is running */
+    T& operator[](int slot) { return slots[slot]; }
+    
+private:
+    enum { INDEX = 3, FRESH = 4 };
+    
+    T slots[3];
+    
+    /** The slot between the two threads, and whether it holds a
+        value the consumer hasn't seen */
+    std::atomic<int> middle;
+    
+    /** Owned by the consumer and producer respectively */
+    int front;
+    int back;
+};
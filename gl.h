@@ -4,6 +4,6 @@
 #include <GLUT/glut.h>
 #else
 #include <GL/glew.h>
+#include <GL/gl.h>
+#include <GL/glut.h>
 #endif
-
-#include <GL/glfw.h>
\ No newline at end of file